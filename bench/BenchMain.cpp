@@ -0,0 +1,971 @@
+// Micro-benchmarks for the parser, cue lookup, subtitle rendering, the
+// progress bar, the pixel kernels, frame sources and a whole frame of the
+// compositing pipeline up to 8K. Results go out as one JSON document so
+// runs of different releases can be diffed. Kernels that promise bit-exact
+// output are checked first; a failed check makes the exit status 3.
+//
+//   player_bench [--quick] [--filter substring] [--out results.json]
+
+#include "app/PlayerApp.hpp"
+#include "render/BlendKernels.hpp"
+#include "render/GlyphAtlas.hpp"
+#include "render/SubtitleRenderer.hpp"
+#include "subs/SrtParser.hpp"
+#include "subs/SubtitleSearchIndex.hpp"
+#include "subs/SubtitleTrack.hpp"
+#include "video/RawVideoSource.hpp"
+#include "video/SyntheticSource.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <variant>
+#include <vector>
+
+// The overlay passes are private; this is the one outside caller.
+struct PlayerAppBench {
+    static void drawProgressBar(const PlayerApp& app, cv::Mat& frame, int64_t t_ms) {
+        app.drawProgressBar(frame, t_ms);
+    }
+    static void drawHud(const PlayerApp& app, cv::Mat& frame, int64_t t_ms) {
+        app.drawHud(frame, t_ms);
+    }
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    bool quick = false;
+    std::string filter;
+    std::filesystem::path out;
+};
+
+struct Result {
+    std::string name;
+    std::string variant;
+    uint64_t iterations = 0;
+    double nsPerOp = 0.0;     // median over samples
+    double minNsPerOp = 0.0;
+    double itemsPerOp = 1.0;  // cues per parse, etc.
+};
+
+// Keeps results alive so the optimizer cannot drop the measured work.
+volatile uint64_t gSink = 0;
+
+void keep(uint64_t v) { gSink = gSink + v; }
+
+class Bench {
+public:
+    explicit Bench(Options opt) : opt_(std::move(opt)) {}
+
+    bool enabled(std::string_view name, std::string_view variant) const {
+        if (opt_.filter.empty()) return true;
+        const std::string full = std::string(name) + "/" + std::string(variant);
+        return full.find(opt_.filter) != std::string::npos;
+    }
+
+    // Calls op() in batches sized to last at least ~20 ms, then records the
+    // median and best batch.
+    template <class Op>
+    void run(std::string name, std::string variant, Op&& op, double itemsPerOp = 1.0) {
+        if (!enabled(name, variant)) return;
+
+        for (int i = 0; i < 2; ++i) op();  // warm caches and lazy state
+
+        const auto batchNs = [&](uint64_t n) {
+            const auto t0 = Clock::now();
+            for (uint64_t i = 0; i < n; ++i) op();
+            return static_cast<double>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+        };
+
+        constexpr double kTargetNs = 20e6;
+        uint64_t n = 1;
+        double ns = batchNs(n);
+        while (ns < kTargetNs && n < (uint64_t{1} << 30)) {
+            n *= ns > 0.0 ? std::clamp<uint64_t>(static_cast<uint64_t>(kTargetNs / ns) + 1, 2, 100) : 100;
+            ns = batchNs(n);
+        }
+
+        const int samples = opt_.quick ? 3 : 7;
+        std::vector<double> perOp;
+        for (int s = 0; s < samples; ++s) perOp.push_back(batchNs(n) / static_cast<double>(n));
+        std::sort(perOp.begin(), perOp.end());
+
+        Result r;
+        r.name = std::move(name);
+        r.variant = std::move(variant);
+        r.iterations = n * static_cast<uint64_t>(samples);
+        r.nsPerOp = perOp[perOp.size() / 2];
+        r.minNsPerOp = perOp.front();
+        r.itemsPerOp = itemsPerOp;
+
+        std::cerr << r.name << "/" << r.variant << ": " << r.nsPerOp << " ns/op\n";
+        results_.push_back(std::move(r));
+    }
+
+    void check(std::string name, uint64_t cases, uint64_t mismatches) {
+        std::cerr << name << ": " << cases << " cases, " << mismatches << " mismatches\n";
+        checks_.push_back({std::move(name), cases, mismatches});
+    }
+
+    bool checksPassed() const {
+        return std::all_of(checks_.begin(), checks_.end(), [](const Check& c) { return c.mismatches == 0; });
+    }
+
+    // Heap footprint of a data structure, reported next to its timings.
+    void footprint(std::string name, std::string variant, uint64_t bytes, uint64_t items) {
+        if (!enabled(name, variant)) return;
+        std::cerr << name << "/" << variant << ": " << bytes << " bytes ("
+                  << (items ? bytes / items : 0) << " per item)\n";
+        footprints_.push_back({std::move(name), std::move(variant), bytes, items});
+    }
+
+    void skip(std::string name, std::string reason) {
+        std::cerr << name << ": skipped (" << reason << ")\n";
+        skipped_.emplace_back(std::move(name), std::move(reason));
+    }
+
+    void writeJson(std::ostream& os) const {
+        os << "{\n"
+           << "  \"schema\": 1,\n"
+           << "  \"opencv\": \"" << CV_VERSION << "\",\n"
+           << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+           << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+           << "  \"quick\": " << (opt_.quick ? "true" : "false") << ",\n"
+           << "  \"results\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const Result& r = results_[i];
+            os << (i ? ",\n" : "\n")
+               << "    {\"name\": \"" << r.name << "\", \"variant\": \"" << r.variant << "\""
+               << ", \"iterations\": " << r.iterations
+               << ", \"ns_per_op\": " << r.nsPerOp
+               << ", \"min_ns_per_op\": " << r.minNsPerOp
+               << ", \"items_per_second\": " << (r.nsPerOp > 0.0 ? r.itemsPerOp * 1e9 / r.nsPerOp : 0.0)
+               << "}";
+        }
+        os << "\n  ],\n  \"checks\": [";
+        for (size_t i = 0; i < checks_.size(); ++i) {
+            const Check& c = checks_[i];
+            os << (i ? ",\n" : "\n")
+               << "    {\"name\": \"" << c.name << "\", \"cases\": " << c.cases
+               << ", \"mismatches\": " << c.mismatches
+               << ", \"passed\": " << (c.mismatches == 0 ? "true" : "false") << "}";
+        }
+        os << "\n  ],\n  \"memory\": [";
+        for (size_t i = 0; i < footprints_.size(); ++i) {
+            const Footprint& f = footprints_[i];
+            os << (i ? ",\n" : "\n")
+               << "    {\"name\": \"" << f.name << "\", \"variant\": \"" << f.variant << "\""
+               << ", \"bytes\": " << f.bytes << ", \"items\": " << f.items
+               << ", \"bytes_per_item\": " << (f.items ? static_cast<double>(f.bytes) / f.items : 0.0) << "}";
+        }
+        os << "\n  ],\n  \"skipped\": [";
+        for (size_t i = 0; i < skipped_.size(); ++i) {
+            os << (i ? ",\n" : "\n")
+               << "    {\"name\": \"" << skipped_[i].first << "\", \"reason\": \"" << skipped_[i].second << "\"}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    bool quick() const { return opt_.quick; }
+
+private:
+    struct Check {
+        std::string name;
+        uint64_t cases = 0;
+        uint64_t mismatches = 0;
+    };
+
+    struct Footprint {
+        std::string name;
+        std::string variant;
+        uint64_t bytes = 0;
+        uint64_t items = 0;
+    };
+
+    Options opt_;
+    std::vector<Result> results_;
+    std::vector<Check> checks_;
+    std::vector<Footprint> footprints_;
+    std::vector<std::pair<std::string, std::string>> skipped_;
+};
+
+std::string timestamp(int64_t ms) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%02lld:%02lld:%02lld,%03lld",
+                  static_cast<long long>(ms / 3600000), static_cast<long long>(ms / 60000 % 60),
+                  static_cast<long long>(ms / 1000 % 60), static_cast<long long>(ms % 1000));
+    return buf;
+}
+
+// Dialogue-like SRT: cues a few seconds long, one or two lines, and now and
+// then an overlap with the previous cue.
+void writeSrt(const std::filesystem::path& path, size_t cues) {
+    static const char* const kWords[] = {
+        "the", "you", "what", "we", "going", "there", "never", "again", "tonight", "maybe",
+        "listen", "something", "happened", "before", "remember", "everyone", "outside", "really",
+    };
+    std::mt19937 rng(static_cast<unsigned>(cues));
+    std::uniform_int_distribution<int> word(0, std::size(kWords) - 1);
+    std::uniform_int_distribution<int> lineLen(2, 9);
+    // Tighter gaps on huge tracks keep timestamps under the 100 h an SRT
+    // hh field can hold.
+    const int maxGap = static_cast<int>(std::min<size_t>(4000, 500'000'000 / cues));
+    std::uniform_int_distribution<int> gap(std::min(300, maxGap / 4), maxGap);
+    std::uniform_int_distribution<int> len(800, 5000);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    int64_t t = 0;
+    for (size_t i = 1; i <= cues; ++i) {
+        t += gap(rng);
+        out << i << "\n" << timestamp(t) << " --> " << timestamp(t + len(rng)) << "\n";
+        const int lines = 1 + (rng() % 3 == 0);
+        for (int l = 0; l < lines; ++l) {
+            const int n = lineLen(rng);
+            for (int w = 0; w < n; ++w) out << (w ? " " : "") << kWords[word(rng)];
+            out << "\n";
+        }
+        out << "\n";
+    }
+}
+
+std::string cueLabel(size_t n) {
+    if (n >= 1000000) return std::to_string(n / 1000000) + "M";
+    return std::to_string(n / 1000) + "k";
+}
+
+// Cue by cue: times and text.
+bool sameCues(const SubtitleTrack& a, const SubtitleTrack& b) {
+    if (a.size() != b.size()) return false;
+    const CueRange x = a.startingAfter(INT64_MIN, a.size());
+    const CueRange y = b.startingAfter(INT64_MIN, b.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+        if (x[i].start_ms != y[i].start_ms || x[i].end_ms != y[i].end_ms || x[i].text != y[i].text) return false;
+    }
+    return true;
+}
+
+// The track a parse produced, or the error it threw, as one comparable result.
+template <class Parse>
+std::variant<SubtitleTrack, std::string> parseOutcome(Parse&& parse) {
+    try {
+        return parse();
+    } catch (const SrtParser::ParseError& e) {
+        return std::string(e.what());
+    }
+}
+
+bool sameOutcome(const std::variant<SubtitleTrack, std::string>& a,
+                 const std::variant<SubtitleTrack, std::string>& b) {
+    if (a.index() != b.index()) return false;
+    if (a.index() == 1) return std::get<1>(a) == std::get<1>(b);
+    return sameCues(std::get<0>(a), std::get<0>(b));
+}
+
+// Split parses, the getline reference parser and the sequential scan must
+// agree on SRT quirks too: cues without an index (whose next line is
+// dropped, blank or not), runs of blank lines, CRLF, padding, digit-only
+// text that looks like an index. Big enough to be split across threads.
+void checkParserQuirks(Bench& b, const std::filesystem::path& dir) {
+    static const char* const kPieces[] = {
+        "12\n00:00:01,000 --> 00:00:02,000\nHello\n\n",
+        "00:00:09,000 --> 00:00:10,000\n\n5\n00:00:01,000 --> 00:00:02,000\nfiller\n\n",
+        "\r\n\r\n34\r\n00:00:03,000 --> 00:00:04,500\r\nCRLF line\r\nsecond\r\n\r\n",
+        "00:00:05,000 --> 00:00:06,000\ndropped line\nkept line\n\n",
+        "7\n  00:00:07,000 -->00:00:08,000  \n  padded text  \n\n\n\n",
+        "99\n00:01:00,000 --> 00:01:01,000\n42\n\n",
+    };
+
+    std::mt19937 rng(17);
+    std::string data;
+    while (data.size() < SrtParser::kParallelMinBytes + (1u << 20)) data += kPieces[rng() % std::size(kPieces)];
+
+    const auto path = dir / "quirks.srt";
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+
+    const SrtParser sequential(1);
+    const auto expected = parseOutcome([&] { return sequential.parseBuffer(data); });
+
+    uint64_t cases = 0;
+    uint64_t mismatches = 0;
+    auto compare = [&](const std::variant<SubtitleTrack, std::string>& got) {
+        ++cases;
+        if (!sameOutcome(got, expected)) ++mismatches;
+    };
+    compare(parseOutcome([&] { return SrtParser(0).parseBuffer(data); }));
+    compare(parseOutcome([&] { return SrtParser(4).parseBuffer(data); }));
+    compare(parseOutcome([&] { return sequential.parseFile(path); }));
+    compare(parseOutcome([&] { return sequential.parseFileStream(path); }));
+
+    // A bad timeline late in the file: every path reports the same line.
+    const std::string broken = data + "8\nnot a timeline\n\n";
+    const auto failed = parseOutcome([&] { return sequential.parseBuffer(broken); });
+    ++cases;
+    if (failed.index() != 1 || !sameOutcome(parseOutcome([&] { return SrtParser(4).parseBuffer(broken); }), failed))
+        ++mismatches;
+
+    b.check("srt.quirks.match_sequential", cases, mismatches);
+}
+
+void benchParser(Bench& b, const std::filesystem::path& dir) {
+    std::vector<size_t> sizes = {10000, 100000, 1000000};
+    if (b.quick()) sizes.pop_back();
+
+    uint64_t splitCases = 0;
+    uint64_t splitMismatches = 0;
+    uint64_t cacheCases = 0;
+    uint64_t cacheMismatches = 0;
+
+    for (size_t n : sizes) {
+        if (!b.enabled("srt.parseFile", cueLabel(n)) && !b.enabled("srt.parseFile", cueLabel(n) + "-1t") &&
+            !b.enabled("track.bytes", cueLabel(n)) &&
+            !b.enabled("track.loadCache", cueLabel(n))) continue;
+        const auto path = dir / ("cues-" + cueLabel(n) + ".srt");
+        writeSrt(path, n);
+
+        SrtParser parser;
+        b.run("srt.parseFile", cueLabel(n), [&] {
+            keep(parser.parseFile(path).size());
+        }, static_cast<double>(n));
+
+        // Same file on one thread, to show what the parallel split buys.
+        const SrtParser sequential(1);
+        b.run("srt.parseFile", cueLabel(n) + "-1t", [&] {
+            keep(sequential.parseFile(path).size());
+        }, static_cast<double>(n));
+
+        const SubtitleTrack track = parser.parseFile(path);
+        b.footprint("track.bytes", cueLabel(n), track.bytes(), track.size());
+
+        // Forced splits too, so one-core machines still check the split path.
+        const SubtitleTrack reference = sequential.parseFile(path);
+        const SubtitleTrack forced = SrtParser(4).parseFile(path);
+        for (const SubtitleTrack* split : {&track, &forced}) {
+            ++splitCases;
+            if (!sameCues(*split, reference)) ++splitMismatches;
+        }
+
+        // saveCache -> loadCache must give back the parsed cues.
+        if (track.saveCache(path)) {
+            const std::optional<SubtitleTrack> cached = SubtitleTrack::loadCache(path);
+            ++cacheCases;
+            bool same = cached && sameCues(*cached, reference);
+            // The interval tree comes from the file too.
+            const int64_t last = reference.size() ? reference.startingAfter(INT64_MIN, reference.size()).back().end_ms : 0;
+            for (int64_t t = 0; same && t <= last; t += std::max<int64_t>(1, last / 1024)) {
+                const auto x = cached->activeAt(t);
+                const auto y = reference.activeAt(t);
+                same = x.has_value() == y.has_value() && (!x || (x->start_ms == y->start_ms && x->text == y->text));
+            }
+            if (!same) ++cacheMismatches;
+
+            b.run("track.loadCache", cueLabel(n), [&] {
+                keep(SubtitleTrack::loadCache(path)->size());
+            }, static_cast<double>(n));
+        }
+    }
+
+    if (splitCases) b.check("srt.parseFile.matches_sequential", splitCases, splitMismatches);
+    if (cacheCases) b.check("track.loadCache.matches_parse", cacheCases, cacheMismatches);
+}
+
+void benchLookup(Bench& b, const std::filesystem::path& dir) {
+    if (!b.enabled("track.activeAt", "sequential") && !b.enabled("track.activeAt", "random") &&
+        !b.enabled("track.activeAt", "seek")) return;
+
+    constexpr size_t kCues = 100000;
+    const auto path = dir / "lookup.srt";
+    writeSrt(path, kCues);
+    const SubtitleTrack track = SrtParser().parseFile(path);
+
+    int64_t end = 0;
+    for (const CueView& c : track.startingAfter(-1, track.size())) end = std::max(end, c.end_ms);
+
+    constexpr size_t kQueries = 1 << 14;
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> anywhere(0, end);
+
+    // Playback: one query per 25 fps frame.
+    std::vector<int64_t> sequential(kQueries);
+    const int64_t startAt = anywhere(rng) / 2;
+    for (size_t i = 0; i < kQueries; ++i) sequential[i] = startAt + static_cast<int64_t>(i) * 40;
+
+    std::vector<int64_t> random(kQueries);
+    for (auto& t : random) t = anywhere(rng);
+
+    // Scrubbing: short playback runs between jumps.
+    std::vector<int64_t> seeky(kQueries);
+    int64_t t = 0;
+    for (size_t i = 0; i < kQueries; ++i) {
+        if (i % 12 == 0) t = anywhere(rng);
+        seeky[i] = t;
+        t += 40;
+    }
+
+    const std::pair<const char*, const std::vector<int64_t>*> patterns[] = {
+        {"sequential", &sequential}, {"random", &random}, {"seek", &seeky},
+    };
+    for (const auto& [name, queries] : patterns) {
+        size_t i = 0;
+        b.run("track.activeAt", name, [&, q = queries] {
+            const std::optional<CueView> c = track.activeAt((*q)[i++ & (kQueries - 1)]);
+            keep(c ? static_cast<uint64_t>(c->start_ms) : 0);
+        });
+    }
+}
+
+// find() against a scan of every cue, on mixed-case Latin, Latin-1 and
+// Cyrillic text. Each word is written in several spellings that must fold
+// to the same normalized word, so the scan needs no tokenizer of its own.
+void checkSearch(Bench& b) {
+    struct Word {
+        std::vector<std::string_view> spellings;
+        std::string_view normalized;
+    };
+    static const Word kWords[] = {
+        {{"hello", "Hello", "HELLO"}, "hello"},
+        {{"station", "Station", "STATION"}, "station"},
+        {{"café", "Café", "CAFÉ"}, "café"},
+        {{"straße", "Straße", "STRAßE"}, "straße"},
+        {{"привет", "Привет", "ПРИВЕТ"}, "привет"},
+        {{"мир", "Мир", "МИР"}, "мир"},
+        {{"ёлка", "Ёлка", "ЁЛКА", "елка", "Елка"}, "елка"},
+        {{"ещё", "Ещё", "ЕЩЕ"}, "еще"},
+        {{"вокзал", "Вокзал", "ВОКЗАЛ"}, "вокзал"},
+        {{"ђак", "Ђак", "ЂАК"}, "ђак"},
+        {{"42", "42"}, "42"},
+        {{"r2d2", "R2D2", "R2d2"}, "r2d2"},
+    };
+    static const char* const kSeparators[] = {" ", ", ", " — ", " «", "» ", "! ", "...", "\n", "\"", " – "};
+
+    std::mt19937 rng(23);
+    auto spell = [&](const Word& w) { return w.spellings[rng() % w.spellings.size()]; };
+    // The first four words are common enough to get bitsets, the rest are
+    // rare, so both intersection paths and their mix are covered.
+    auto pick = [&]() -> const Word& {
+        const size_t k = rng() % 256;
+        return kWords[k < std::size(kWords) ? k : k % 4];
+    };
+
+    constexpr size_t kCues = 2000;
+    CueBuffer buf;
+    std::vector<std::vector<std::string_view>> cueWords(kCues);
+    std::string line;
+    for (size_t i = 0; i < kCues; ++i) {
+        line.clear();
+        const int words = 1 + static_cast<int>(rng() % 6);
+        for (int k = 0; k < words; ++k) {
+            const Word& w = pick();
+            line += kSeparators[rng() % std::size(kSeparators)];
+            line += spell(w);
+            cueWords[i].push_back(w.normalized);
+        }
+        buf.addLine(line);
+        buf.commit(static_cast<int64_t>(i) * 3000, static_cast<int64_t>(i) * 3000 + 2000);
+    }
+    const SubtitleTrack track(std::move(buf));
+
+    std::vector<CueView> cues;
+    for (const CueView& c : track.startingAfter(-1, track.size())) cues.push_back(c);
+    const SubtitleSearchIndex index(std::move(cues));
+
+    uint64_t cases = 0;
+    uint64_t mismatches = 0;
+    std::vector<uint32_t> out;
+    auto compare = [&](std::string_view query, const std::vector<std::string_view>& words) {
+        std::vector<uint32_t> expected;
+        for (uint32_t id = 0; id < kCues && !words.empty(); ++id) {
+            const auto& have = cueWords[id];
+            if (std::all_of(words.begin(), words.end(), [&](std::string_view w) {
+                    return std::find(have.begin(), have.end(), w) != have.end();
+                })) expected.push_back(id);
+        }
+        const std::span<const uint32_t> found = index.find(query, out);
+        std::vector<uint32_t> got(found.begin(), found.end());
+        std::sort(got.begin(), got.end());
+        ++cases;
+        if (got != expected) ++mismatches;
+    };
+
+    for (int q = 0; q < 512; ++q) {
+        std::string query;
+        std::vector<std::string_view> words;
+        const int n = 1 + static_cast<int>(rng() % 3);
+        for (int k = 0; k < n; ++k) {
+            const Word& w = kWords[rng() % std::size(kWords)];
+            query += k ? kSeparators[rng() % std::size(kSeparators)] : "";
+            query += spell(w);
+            words.push_back(w.normalized);
+        }
+        compare(query, words);
+    }
+
+    compare("", {});
+    compare(" , — ", {});
+    compare("nosuchword", {"nosuchword"});
+    compare("hello nosuchword", {"hello", "nosuchword"});
+    compare("hell", {"hell"});
+    compare("«ЁЛКА»", {"елка"});
+    compare("Ещё, ПРИВЕТ!", {"еще", "привет"});
+
+    b.check("search.find.matches_scan", cases, mismatches);
+}
+
+// Word search over a large track. The dialogue generator above has too
+// few distinct words, so these cues draw from 20k made-up words with
+// Zipf-like frequencies, the way real dialogue does.
+void benchSearch(Bench& b) {
+    std::vector<size_t> sizes = {100000, 1000000};
+    if (b.quick()) sizes.pop_back();
+
+    constexpr int kVocab = 20000;
+    std::vector<std::string> vocab(kVocab);
+    for (int i = 0; i < kVocab; ++i) vocab[i] = "w" + std::to_string(i);
+
+    for (size_t n : sizes) {
+        const std::string label = cueLabel(n);
+        if (!b.enabled("search.find", label + "-rare") && !b.enabled("search.find", label + "-pair") &&
+            !b.enabled("search.find", label + "-common") && !b.enabled("search.bytes", label)) continue;
+
+        std::mt19937 rng(static_cast<unsigned>(n));
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        const auto pick = [&] { return std::min(kVocab - 1, static_cast<int>(std::pow(kVocab, u(rng))) - 1); };
+
+        CueBuffer buf;
+        std::string line;
+        for (size_t i = 0; i < n; ++i) {
+            line.clear();
+            const int words = 3 + static_cast<int>(rng() % 8);
+            for (int w = 0; w < words; ++w) line += (w ? " " : "") + vocab[pick()];
+            buf.addLine(line);
+            buf.commit(static_cast<int64_t>(i) * 3000, static_cast<int64_t>(i) * 3000 + 2000);
+        }
+        const SubtitleTrack track(std::move(buf));
+
+        std::vector<CueView> cues;
+        for (const CueView& c : track.startingAfter(-1, track.size())) cues.push_back(c);
+        const SubtitleSearchIndex index(std::move(cues));
+        b.footprint("search.bytes", label, index.bytes(), index.size());
+
+        // Two words of one cue, so every query has at least one hit.
+        constexpr size_t kQueries = 1024;
+        std::vector<std::string> pairs(kQueries);
+        for (auto& q : pairs) {
+            const std::string_view text = index.cue(static_cast<uint32_t>(rng() % index.size())).text;
+            q = std::string(text.substr(0, text.find(' ', text.find(' ') + 1)));
+        }
+
+        std::vector<uint32_t> out;
+        size_t i = 0;
+        b.run("search.find", label + "-rare", [&] { keep(index.find(vocab[kVocab - 1 - (i++ % 64)], out).size()); });
+        b.run("search.find", label + "-pair", [&] { keep(index.find(pairs[i++ % kQueries], out).size()); });
+        b.run("search.find", label + "-common", [&] { keep(index.find("w0 w1", out).size()); });
+    }
+}
+
+void benchRenderer(Bench& b) {
+    const CueView shortCue{0, 2000, "Where were you last night?"};
+    const CueView longCue{0, 6000,
+        "I told you already, I was at the station waiting for the last train home,\n"
+        "and when it did not come I walked the whole way along the river,\n"
+        "which, in case you have forgotten, is not a short walk at all."};
+    const CueView cyrillicCue{0, 2000, "Где ты был вчера вечером?"};
+
+    const std::pair<const char*, cv::Size> sizes[] = {
+        {"720p", {1280, 720}}, {"1080p", {1920, 1080}}, {"4k", {3840, 2160}},
+    };
+    const std::pair<const char*, const CueView*> cues[] = {
+        {"short", &shortCue}, {"long", &longCue}, {"cyrillic", &cyrillicCue},
+    };
+
+    RenderStyle style;
+    style.reservedBottomPx = 40;
+
+    for (const auto& [res, size] : sizes) {
+        cv::Mat frame(size, CV_8UC3, cv::Scalar(60, 90, 120));
+        for (const auto& [kind, cue] : cues) {
+            const std::string variant = std::string(res) + "-" + kind;
+            if (!b.enabled("renderer.draw", variant) && !b.enabled("renderer.rasterize", variant)) continue;
+
+            SubtitleRenderer renderer(style);
+            b.run("renderer.draw", variant, [&] { renderer.draw(frame, *cue); });
+
+            // Cache miss cost: the first frame a cue appears on.
+            b.run("renderer.rasterize", variant, [&] {
+                keep(SubtitleRenderer::rasterize(style, *cue, frame.cols).bytes());
+            });
+        }
+    }
+}
+
+// darkenInPlace must match cv::addWeighted with a black overlay byte for
+// byte, on every instruction set and on the threaded path.
+void checkDarken(Bench& b) {
+    std::mt19937 rng(7);
+    const double keeps[] = {0.0, 0.35, 0.5, 0.65, 1.0 - 0.35, 0.999, 1.0, 1.0 / 3.0};
+
+    std::vector<KernelIsa> isas = {KernelIsa::Scalar};
+    if (bestKernelIsa() >= KernelIsa::Sse2) isas.push_back(KernelIsa::Sse2);
+    if (bestKernelIsa() >= KernelIsa::Avx2) isas.push_back(KernelIsa::Avx2);
+
+    uint64_t cases = 0;
+    uint64_t mismatches = 0;
+    auto compare = [&](const cv::Mat& src, double keep, auto&& darken) {
+        cv::Mat expected;
+        cv::addWeighted(cv::Mat(src.size(), src.type(), cv::Scalar::all(0)), 1.0 - keep,
+                        src, keep, 0.0, expected);
+
+        // Work on a sub-rectangle of a larger image so rows are not contiguous.
+        cv::Mat canvas(src.rows + 2, src.cols + 3, src.type(), cv::Scalar::all(0));
+        cv::Mat roi = canvas(cv::Rect(1, 1, src.cols, src.rows));
+        src.copyTo(roi);
+        darken(roi, keep);
+
+        ++cases;
+        if (cv::norm(roi, expected, cv::NORM_INF) != 0.0) ++mismatches;
+    };
+
+    // Every byte value, then random images with awkward widths.
+    cv::Mat ramp(1, 256, CV_8UC1);
+    for (int v = 0; v < 256; ++v) ramp.at<uchar>(0, v) = static_cast<uchar>(v);
+
+    for (double keep : keeps) {
+        for (int i = 0; i < 24; ++i) {
+            const double k = i == 0 ? keep : std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            cv::Mat img(1 + static_cast<int>(rng() % 9), 1 + static_cast<int>(rng() % 131),
+                        i % 2 ? CV_8UC3 : CV_8UC1);
+            cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(256));
+
+            for (KernelIsa isa : isas) {
+                auto with = [isa](cv::Mat& roi, double kk) { darkenInPlaceWith(isa, roi, kk); };
+                compare(ramp, k, with);
+                compare(img, k, with);
+            }
+        }
+    }
+
+    // Big enough to be split across threads.
+    cv::Mat frame(2160, 3840, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+    for (double keep : keeps) {
+        compare(frame, keep, [](cv::Mat& roi, double kk) { darkenInPlace(roi, kk); });
+    }
+
+    b.check("kernel.darken.matches_addWeighted", cases, mismatches);
+}
+
+// compositeLayer with the same alpha on every channel is blitPremultiplied.
+void checkComposite(Bench& b) {
+    std::mt19937 rng(11);
+
+    uint64_t cases = 0;
+    uint64_t mismatches = 0;
+    auto compare = [&](cv::Size frameSize, cv::Size layerSize, cv::Point at, auto&& composite) {
+        cv::Mat alpha(layerSize, CV_8UC1);
+        cv::randu(alpha, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::Mat keep;
+        cv::cvtColor(alpha, keep, cv::COLOR_GRAY2BGR);
+        cv::subtract(cv::Scalar::all(255), keep, keep);
+
+        // Premultiplied colour never exceeds alpha.
+        cv::Mat color(layerSize, CV_8UC3);
+        cv::randu(color, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::Mat alpha3;
+        cv::cvtColor(alpha, alpha3, cv::COLOR_GRAY2BGR);
+        cv::min(color, alpha3, color);
+
+        cv::Mat frame(frameSize, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::Mat expected = frame.clone();
+        blitPremultiplied(expected, color, alpha, at);
+
+        composite(frame, color, keep, at);
+        ++cases;
+        if (cv::norm(frame, expected, cv::NORM_INF) != 0.0) ++mismatches;
+    };
+
+    for (int i = 0; i < 64; ++i) {
+        const cv::Size frameSize(1 + static_cast<int>(rng() % 97), 1 + static_cast<int>(rng() % 9));
+        const cv::Size layerSize(1 + static_cast<int>(rng() % 131), 1 + static_cast<int>(rng() % 9));
+        const cv::Point at(static_cast<int>(rng() % 41) - 20, static_cast<int>(rng() % 9) - 4);
+
+        for (KernelIsa isa : {KernelIsa::Scalar, KernelIsa::Sse2, KernelIsa::Avx2}) {
+            if (isa > bestKernelIsa()) continue;
+            compare(frameSize, layerSize, at, [isa](cv::Mat& f, const cv::Mat& c, const cv::Mat& k, cv::Point p) {
+                compositeLayerWith(isa, f, c, k, p);
+            });
+        }
+    }
+
+    // A 4K progress panel, split across threads.
+    compare({3840, 2160}, {3840, 77}, {0, 2160 - 77},
+            [](cv::Mat& f, const cv::Mat& c, const cv::Mat& k, cv::Point p) { compositeLayer(f, c, k, p); });
+
+    b.check("kernel.composite.matches_blitPremultiplied", cases, mismatches);
+}
+
+// The atlas must measure ASCII as getTextSize does, or word wrap moves, and
+// the box behind a cue must keep the addWeighted tint the putText matte had.
+void checkRenderer(Bench& b) {
+    const std::string_view texts[] = {
+        "Where were you last night?", "I", "  two  spaces  ", "Tab\tand ~ tilde", "{[(<@#$%^&*>)]}",
+        "which, in case you have forgotten, is not a short walk at all.",
+    };
+
+    uint64_t cases = 0;
+    uint64_t mismatches = 0;
+    for (double scale : {0.5, 1.0, 1.7}) {
+        for (int thickness : {1, 2, 3}) {
+            const GlyphAtlas& glyphs = GlyphAtlas::get(scale, thickness, 1);
+            for (std::string_view text : texts) {
+                int baseline = 0;
+                const cv::Size sz = cv::getTextSize(std::string(text), cv::FONT_HERSHEY_SIMPLEX,
+                                                    scale, thickness, &baseline);
+                ++cases;
+                if (glyphs.textWidth(text) != sz.width || glyphs.height() != sz.height ||
+                    glyphs.baseline() != baseline) ++mismatches;
+            }
+        }
+    }
+    b.check("renderer.atlas.matches_getTextSize", cases, mismatches);
+
+    // The first columns of the box lie left of any outline: black at boxAlpha.
+    cases = 0;
+    mismatches = 0;
+    for (double boxAlpha : {0.35, 0.5, 0.8}) {
+        RenderStyle style;
+        style.boxAlpha = boxAlpha;
+        const std::string text = "Where were you?";
+        const CueSprite sprite = SubtitleRenderer::rasterize(style, CueView{0, 2000, text}, 1280);
+
+        cv::Mat white(1, 1, CV_8UC1, cv::Scalar(255));
+        cv::Mat shaded;
+        cv::addWeighted(cv::Mat(1, 1, CV_8UC1, cv::Scalar(0)), boxAlpha, white, 1.0 - boxAlpha, 0.0, shaded);
+        const int expected = 255 - shaded.at<uchar>(0, 0);
+
+        // Left edge of the box in sprite columns: the centred line, less the
+        // horizontal padding, less where the sprite starts in the frame.
+        const int textWidth = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, style.fontScale,
+                                              style.thickness, nullptr).width;
+        const int x0 = (1280 - textWidth) / 2 - SubtitleRenderer::kBoxPadX - sprite.x;
+        if (x0 < 0 || x0 + 4 > sprite.alpha.cols) {
+            ++mismatches;
+            continue;
+        }
+        uint64_t rows = 0;
+        for (int r = 0; r < sprite.alpha.rows; ++r) {
+            if (sprite.alpha.at<uchar>(r, x0) == 0) continue;
+            ++rows;
+            ++cases;
+            for (int x = x0; x < x0 + 4; ++x) {
+                if (sprite.alpha.at<uchar>(r, x) != expected || sprite.bgr.at<cv::Vec3b>(r, x) != cv::Vec3b(0, 0, 0)) {
+                    ++mismatches;
+                    break;
+                }
+            }
+        }
+        if (rows == 0) ++mismatches;
+    }
+    b.check("renderer.box.matches_addWeighted", cases, mismatches);
+}
+
+void benchDarken(Bench& b) {
+    const std::pair<const char*, cv::Size> sizes[] = {
+        {"1080p", {1920, 1080}}, {"4k", {3840, 2160}}, {"8k", {7680, 4320}},
+    };
+
+    for (const auto& [res, size] : sizes) {
+        cv::Mat frame;
+        auto canvas = [&]() -> cv::Mat& {
+            if (frame.empty()) frame = cv::Mat(size, CV_8UC3, cv::Scalar(60, 90, 120));
+            return frame;
+        };
+
+        // keep = 1 leaves the pixels alone, so repeated runs see the same data.
+        for (KernelIsa isa : {KernelIsa::Scalar, KernelIsa::Sse2, KernelIsa::Avx2}) {
+            if (isa > bestKernelIsa()) continue;
+            const std::string variant = std::string(kernelIsaName(isa)) + "-" + res;
+            if (!b.enabled("kernel.darken", variant)) continue;
+            cv::Mat& f = canvas();
+            b.run("kernel.darken", variant, [&] { darkenInPlaceWith(isa, f, 1.0); });
+        }
+
+        const std::string variant = std::string("threaded-") + res;
+        if (!b.enabled("kernel.darken", variant)) continue;
+        cv::Mat& f = canvas();
+        b.run("kernel.darken", variant, [&] { darkenInPlace(f, 1.0); });
+    }
+}
+
+void benchProgressBar(Bench& b) {
+    if (!b.enabled("hud.drawProgressBar", "720p") && !b.enabled("hud.drawProgressBar", "1080p") &&
+        !b.enabled("hud.drawProgressBar", "4k")) return;
+
+    // The bar only needs a duration; ten seconds of generated frames will do.
+    PlayerApp app(std::make_unique<SyntheticSource>(cv::Size(64, 36), 25.0, 10000), nullptr, SubtitleRenderer{});
+
+    const std::pair<const char*, cv::Size> sizes[] = {
+        {"720p", {1280, 720}}, {"1080p", {1920, 1080}}, {"4k", {3840, 2160}},
+    };
+    for (const auto& [res, size] : sizes) {
+        cv::Mat frame(size, CV_8UC3, cv::Scalar(60, 90, 120));
+        int64_t t = 0;
+        b.run("hud.drawProgressBar", res, [&] {
+            PlayerAppBench::drawProgressBar(app, frame, t);
+            t = (t + 40) % 10000;
+        });
+    }
+}
+
+// Reads the next frame, starting over at the end.
+void nextFrame(FrameSource& src, cv::Mat& frame) {
+    if (src.read(frame)) return;
+    src.seekMs(0);
+    src.read(frame);
+}
+
+// Frame delivery without a codec: generated frames, and 1080p Y4M and raw
+// BGR read from a mapped file.
+void benchSources(Bench& b, const std::filesystem::path& dir) {
+    const cv::Size size(1920, 1080);
+    constexpr int kFrames = 8;
+
+    if (b.enabled("source.read", "synthetic-1080p")) {
+        SyntheticSource src(size, 30.0, 10000);
+        cv::Mat frame;
+        b.run("source.read", "synthetic-1080p", [&] { nextFrame(src, frame); });
+    }
+
+    if (!b.enabled("source.read", "y4m-1080p") && !b.enabled("source.read", "bgr-1080p")) return;
+
+    SyntheticSource pattern(size, 30.0, 1000);
+    const auto y4m = dir / "frames.y4m";
+    const auto bgr = dir / "frames.bgr";
+    {
+        std::ofstream y(y4m, std::ios::binary);
+        std::ofstream r(bgr, std::ios::binary);
+        y << "YUV4MPEG2 W" << size.width << " H" << size.height << " F30:1 Ip A1:1 C420jpeg\n";
+
+        cv::Mat frame, yuv;
+        for (int i = 0; i < kFrames; ++i) {
+            pattern.read(frame);
+            cv::cvtColor(frame, yuv, cv::COLOR_BGR2YUV_I420);
+            y << "FRAME\n";
+            y.write(reinterpret_cast<const char*>(yuv.data), static_cast<std::streamsize>(yuv.total()));
+            r.write(reinterpret_cast<const char*>(frame.data), static_cast<std::streamsize>(frame.total() * 3));
+        }
+        if (!y || !r) {
+            b.skip("source.read", "cannot write raw test video");
+            return;
+        }
+    }
+
+    cv::Mat frame;
+    auto y4mSrc = RawVideoSource::openY4m(y4m);
+    b.run("source.read", "y4m-1080p", [&] { nextFrame(*y4mSrc, frame); });
+
+    auto bgrSrc = RawVideoSource::openBgr(bgr, size, 30.0);
+    b.run("source.read", "bgr-1080p", [&] { nextFrame(*bgrSrc, frame); });
+}
+
+// One frame of the playback pipeline minus the window: take a generated
+// frame, copy it into the display buffer, then subtitles, HUD and bar.
+void benchPipeline(Bench& b) {
+    const std::pair<const char*, cv::Size> sizes[] = {
+        {"1080p", {1920, 1080}}, {"4k", {3840, 2160}}, {"8k", {7680, 4320}},
+    };
+    const CueView cue{0, 2000, "Where were you last night?"};
+
+    RenderStyle style;
+    style.reservedBottomPx = 40;
+
+    for (const auto& [res, size] : sizes) {
+        if (!b.enabled("pipeline.frame", res)) continue;
+
+        SyntheticSource src(size, 30.0, 10000);
+        PlayerApp app(std::make_unique<SyntheticSource>(cv::Size(64, 36), 30.0, 10000), nullptr, SubtitleRenderer{});
+        SubtitleRenderer renderer(style);
+
+        cv::Mat frame, display;
+        b.run("pipeline.frame", res, [&] {
+            nextFrame(src, frame);
+            frame.copyTo(display);
+            renderer.draw(display, cue);
+            PlayerAppBench::drawHud(app, display, src.timeMs());
+            PlayerAppBench::drawProgressBar(app, display, src.timeMs());
+        });
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        Options opt;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (arg == "--quick") {
+                opt.quick = true;
+            } else if (arg == "--filter" && i + 1 < argc) {
+                opt.filter = argv[++i];
+            } else if (arg == "--out" && i + 1 < argc) {
+                opt.out = argv[++i];
+            } else {
+                std::cerr << "Usage: " << argv[0] << " [--quick] [--filter substring] [--out results.json]\n";
+                return 1;
+            }
+        }
+
+        const auto dir = std::filesystem::temp_directory_path() /
+                         ("subplayer-bench-" + std::to_string(::getpid()));
+        std::filesystem::create_directories(dir);
+
+        Bench bench(opt);
+        checkDarken(bench);
+        checkComposite(bench);
+        checkRenderer(bench);
+        checkParserQuirks(bench, dir);
+        checkSearch(bench);
+
+        benchParser(bench, dir);
+        benchLookup(bench, dir);
+        benchSearch(bench);
+        benchRenderer(bench);
+        benchProgressBar(bench);
+        benchSources(bench, dir);
+        benchPipeline(bench);
+        benchDarken(bench);
+
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+
+        if (opt.out.empty()) {
+            bench.writeJson(std::cout);
+        } else {
+            std::ofstream out(opt.out);
+            bench.writeJson(out);
+            if (!out) throw std::runtime_error("Cannot write " + opt.out.string());
+        }
+        return bench.checksPassed() ? 0 : 3;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Fatal: " << e.what() << "\n";
+        return 2;
+    }
+}
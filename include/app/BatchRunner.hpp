@@ -0,0 +1,86 @@
+#pragma once
+
+#include "render/RenderStyle.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+enum class BatchMode {
+    BurnIn,   // export each video with its subtitles burnt in
+    Analyze,  // parse subtitles and index the stream, write nothing but the manifest
+};
+
+struct BatchOptions {
+    std::filesystem::path input;   // directory to scan, or a list file
+    std::filesystem::path outDir;  // outputs and the run manifest
+
+    BatchMode mode = BatchMode::BurnIn;
+    unsigned concurrency = 0;      // 0 = one per hardware thread
+    size_t memoryCapBytes = 0;     // 0 = unlimited
+    unsigned jobsPerFile = 1;      // export segments per video
+    std::string fourcc = "mp4v";
+    RenderStyle style;
+};
+
+struct BatchJob {
+    enum class State { Pending, Done, Failed };
+
+    std::filesystem::path video;
+    std::optional<std::filesystem::path> subs;
+    std::filesystem::path output;  // empty in analysis mode
+
+    // "size:mtime" of the inputs as they were when the job ran.
+    std::string videoStamp;
+    std::string subsStamp;
+
+    State state = State::Pending;
+    int64_t frames = 0;
+    double seconds = 0.0;
+    std::string note;              // analysis result or error message
+};
+
+struct BatchSummary {
+    size_t done = 0;
+    size_t failed = 0;
+    size_t skipped = 0;            // already done by an earlier run
+    int64_t frames = 0;
+    double seconds = 0.0;
+
+    double fps() const { return seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0; }
+};
+
+// Runs one job per video on a work-stealing pool. Progress is kept in a
+// manifest under outDir, rewritten after every job, so a killed run picks up
+// the jobs that had not finished.
+class BatchRunner {
+public:
+    explicit BatchRunner(BatchOptions options);
+
+    BatchSummary run();
+
+    // A directory is scanned recursively for videos; any other file is read
+    // as a list with one "video[<TAB>subs]" per line. Subtitles not named
+    // explicitly are found with autoFindSubtitles.
+    static std::vector<BatchJob> discover(const std::filesystem::path& input,
+                                          const std::filesystem::path& outDir,
+                                          BatchMode mode);
+
+private:
+    BatchOptions opt_;
+    std::vector<BatchJob> jobs_;
+
+    // Guards job states, the manifest file and console output.
+    std::mutex mtx_;
+
+    std::filesystem::path manifestPath() const;
+    void resumeFromManifest();
+    void saveManifest() const;
+
+    size_t estimateBytes(const BatchJob& job) const;
+    void execute(BatchJob& job) const;
+};
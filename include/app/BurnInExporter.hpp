@@ -0,0 +1,57 @@
+#pragma once
+
+#include "render/RenderStyle.hpp"
+#include "subs/SubtitleTrack.hpp"
+#include "video/StreamIndex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ExportOptions {
+    std::filesystem::path input;
+    std::filesystem::path output;
+
+    unsigned jobs = 0;           // 0 = one per hardware thread
+    std::string fourcc = "mp4v";
+    RenderStyle style;
+    size_t spriteBudgetBytes = 64u << 20;  // per segment
+};
+
+struct ExportReport {
+    int64_t frames = 0;
+    double seconds = 0.0;
+    unsigned segments = 0;
+
+    double fps() const { return seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0; }
+};
+
+// Burns subtitles into every frame without a window. The video is cut into
+// contiguous frame ranges that are decoded, composited and encoded in
+// parallel, each with its own VideoCapture/VideoWriter, then stitched in
+// order.
+class BurnInExporter {
+public:
+    explicit BurnInExporter(ExportOptions options);
+
+    ExportReport run(const SubtitleTrack* subs) const;
+
+private:
+    struct Segment {
+        int64_t firstFrame = 0;
+        int64_t frameCount = -1;  // -1 = until the end of the stream
+        std::filesystem::path path;
+        int64_t written = 0;
+    };
+
+    ExportOptions opt_;
+
+    void encodeSegment(Segment& seg,
+                       const SubtitleTrack* subs,
+                       const std::shared_ptr<const StreamIndex>& index) const;
+
+    void stitch(const std::vector<Segment>& segments) const;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+// Buffers reused from frame to frame by the overlay code in PlayerApp, so
+// steady-state compositing never touches the heap.
+class FrameScratch {
+public:
+    enum TextSlot : size_t {
+        HudText,
+        StatsLine,
+        SearchLine,
+        ErrorLine,
+        TextSlotCount
+    };
+
+    std::span<char> text(TextSlot slot) { return texts_[slot]; }
+
+private:
+    std::array<std::array<char, 160>, TextSlotCount> texts_{};
+};
@@ -1,25 +1,53 @@
 #pragma once
 
+#include "app/FrameScratch.hpp"
+#include "app/PresentationScheduler.hpp"
+#include "app/ProgressBarLayer.hpp"
+#include "app/SeekMailbox.hpp"
+#include "render/GlyphStamps.hpp"
 #include "render/SubtitleRenderer.hpp"
-#include "subs/SubtitleTrack.hpp"
-#include "video/VideoSource.hpp"
+#include "subs/SubtitleSearchIndex.hpp"
+#include "subs/SubtitleStream.hpp"
+#include "video/FrameSource.hpp"
 #include "subs/SubtitleTimingController.hpp"
+#include "util/FrameStats.hpp"
+#include "video/ThumbnailIndex.hpp"
 
 
 #include <cstdint>
-#include <optional>
+#include <filesystem>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 class PlayerApp {
 public:
-    PlayerApp(VideoSource video,
-              std::optional<SubtitleTrack> subs,
+    // `subs` may be null; cues appear as the stream parses them.
+    PlayerApp(std::unique_ptr<FrameSource> video,
+              std::shared_ptr<SubtitleStream> subs,
               SubtitleRenderer renderer);
 
     int run();
 
+    // Collects per-stage frame timings for the whole run and writes them to
+    // `jsonOut` on exit. Without this, stats are only gathered while the
+    // overlay is shown.
+    void enableStats(std::filesystem::path jsonOut);
+
+    // Shows a preview above the progress bar while the mouse hovers over it.
+    // Thumbnails come from `<video>.thumbs` or are sampled in the background
+    // with a capture of their own; the playback decoder is never touched.
+    void enableThumbnails(const std::filesystem::path& videoPath);
+
 private:
-    VideoSource video_;
-    std::optional<SubtitleTrack> subs_;
+    friend struct PlayerAppBench;
+
+    std::unique_ptr<FrameSource> video_;
+    std::shared_ptr<SubtitleStream> subs_;
+    std::shared_ptr<const SubtitleSnapshot> subsView_;
+    std::vector<CueView> activeCues_;
     SubtitleTimingController timing_;
     SubtitleRenderer renderer_;
 
@@ -27,35 +55,85 @@ private:
     bool paused_ = false;
     int64_t subsOffsetMs_ = 0;
 
-    int frameDelayMs_ = 40;
+    PresentationScheduler scheduler_;
 
     void handleKey(int key);
     void drawHud(cv::Mat& frame, int64_t t_ms) const;
+    // The parser gave up part way; the HUD says so under the first line.
+    bool subsFailed() const { return subsView_ && !subsView_->error().empty(); }
+    void drawStatsOverlay(cv::Mat& frame) const;
+
+    FrameStats stats_;
+    std::filesystem::path statsPath_;
+    bool showStats_ = false;
 
     bool shouldExit_ = false;
 
     void drawProgressBar(cv::Mat& frame, int64_t t_ms) const;
 
-    struct ProgressBarGeom {
-    bool valid = false;
-    int x0 = 0;
-    int x1 = 0;
-    int y0 = 0;
-    int y1 = 0;
-
-    int frameW = 0;
-    int frameH = 0;
-
-
-    int64_t durMs = 0;
-};
-
-    mutable ProgressBarGeom bar_;
+    // Copies the decoded frame into display_, downscaling it when it is
+    // larger than the window's image area, and returns display_ for the
+    // overlays to be composited onto. The decoded frame is never drawn on,
+    // so a paused frame can be composited again from scratch.
+    cv::Mat& fitToWindow(const cv::Mat& frame);
+    cv::Mat display_;
+    cv::Size shownWindow_;
+
+    // While paused nothing is composited or shown until something on
+    // screen would change: a key, a seek, a resize, the hover preview or
+    // cues still arriving from the parser.
+    bool dirty_ = true;
+    size_t thumbsShown_ = 0;
+    PresentationScheduler::Clock::time_point lastInput_{};
+    bool upToDate() const;
+
+    mutable FrameScratch scratch_;
+    GlyphStamps hudGlyphs_;
+    mutable ProgressBarLayer progressBar_;
     bool draggingBar_ = false;
 
     static void onMouseThunk(int event, int x, int y, int flags, void* userdata);
     void onMouse(int event, int x, int y, int flags);
-    void seekByMouseX(int x);
+    void handleBarMouse(int event, int x, int y, const ProgressBarLayer::Geometry& bar);
+    void seekByMouseX(int x, SeekMode mode);
+    int64_t timeAtX(int x) const;
     bool needRefreshFrame_ = false;
 
+    // Seeks from the mouse and keys are posted here and applied at the top
+    // of the next frame, so a burst of them costs one backend seek.
+    SeekMailbox seeks_;
+    void seekBy(int64_t deltaMs);
+    void applyPendingSeek();
+
+    std::shared_ptr<ThumbnailIndex> thumbs_;
+    int hoverX_ = -1;  // frame x over the bar, -1 when not hovering
+    void drawThumbnail(cv::Mat& frame) const;
+
+    // Subtitle search: '/' opens the prompt, Enter jumps to the first hit
+    // after the playhead, N and P step through the hits. The index is built
+    // in the background once the whole track is parsed.
+    struct PendingSearch {
+        std::atomic<bool> ready{false};
+        std::shared_ptr<const SubtitleSearchIndex> index;  // published by `ready`
+    };
+    std::shared_ptr<PendingSearch> pendingSearch_;
+    std::shared_ptr<const SubtitleSearchIndex> search_;
+    std::string query_;
+    bool typingQuery_ = false;
+    bool searched_ = false;
+    std::vector<uint32_t> hitScratch_;
+    std::vector<uint32_t> hits_;
+    size_t hit_ = 0;
+
+    void adoptSearchIndex();
+    void handleSearchKey(int key);
+    void runSearch();
+    void stepHit(int dir);
+    void jumpToHit(size_t i);
+    bool searchPromptShown() const { return typingQuery_ || !query_.empty(); }
+    void drawSearchPrompt(cv::Mat& frame) const;
+
+    // Declared last so they are stopped and joined before what they fill.
+    std::jthread searchIndexer_;
+    std::jthread thumbnailer_;
 };  
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Master media clock for playback: media time advances with steady_clock
+// from an anchor set on the first frame after start, seek or resume. Frames
+// are due when the clock reaches their PTS.
+class PresentationScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PresentationScheduler(double fps);
+
+    // Forgets the anchor; the next frame shown re-anchors the clock.
+    void invalidate() noexcept { anchored_ = false; }
+    bool anchored() const noexcept { return anchored_; }
+    void anchor(int64_t mediaMs, Clock::time_point now) noexcept;
+
+    Clock::time_point dueTime(int64_t ptsMs) const noexcept;
+
+    // Media time the clock says should be on screen at `now`.
+    double mediaNowMs(Clock::time_point now) const noexcept;
+
+    // How many frames to skip so the next one read is not already a full
+    // frame overdue. After a stall longer than kMaxCatchUp the clock is
+    // re-anchored instead, as skipping seconds of video would look worse.
+    int64_t framesToSkip(int64_t lastPtsMs, Clock::time_point now) noexcept;
+
+    double framePeriodMs() const noexcept { return periodMs_; }
+
+    static constexpr std::chrono::milliseconds kMaxCatchUp{1000};
+
+private:
+    double periodMs_;
+    bool anchored_ = false;
+    int64_t anchorMediaMs_ = 0;
+    Clock::time_point anchorWall_;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "render/GlyphStamps.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// The progress panel kept as a retained layer. Layout, the track and the
+// duration label are rendered once per frame size; the clock label is
+// re-rasterized when its text changes and only the fill/knob span that moved
+// is repainted. Every frame then costs one darkenInPlace for the panel tint
+// and one compositeLayer call.
+class ProgressBarLayer {
+public:
+    // Frame-space layout, also used to hit-test the mouse.
+    struct Geometry {
+        bool valid = false;  // false when there is no bar to click on
+        int x0 = 0;
+        int x1 = 0;
+        int y0 = 0;
+        int y1 = 0;
+
+        int frameW = 0;
+        int frameH = 0;
+
+        int64_t durMs = 0;
+    };
+
+    const Geometry& geometry() const { return geom_; }
+
+    // Brings the layer up to date for t_ms and composites it onto `frame`.
+    // The layout is redone only when the frame size or duration changes.
+    // Draws nothing when the duration is unknown.
+    void draw(cv::Mat& frame, int64_t t_ms, int64_t durMs);
+
+private:
+    Geometry geom_;
+
+    // Layout for the current frame size. Everything but panelTop_ is in
+    // layer coordinates; the layer spans the panel at the frame's bottom.
+    int panelTop_ = 0;
+    int padX_ = 0;
+    int barTop_ = 0;
+    int barH_ = 0;
+    int barCenter_ = 0;
+    int textY_ = 0;
+    int labelW_ = 0;
+    int knobR_ = 0;
+
+    // base_* hold the panel without fill and knob; live_* are what gets
+    // composited. Colour is premultiplied BGR, keep is 255 - alpha.
+    cv::Mat baseColor_;
+    cv::Mat baseKeep_;
+    cv::Mat liveColor_;
+    cv::Mat liveKeep_;
+
+    cv::Mat knobColor_;
+    cv::Mat knobAlpha_;
+
+    std::unique_ptr<GlyphStamps> labelGlyphs_;
+    std::array<char, 32> clock_{};
+    size_t clockLen_ = 0;  // 0 forces the next label to be drawn
+
+    int fillX_ = -1;  // fill end currently painted into live_*, -1 for none
+
+    void layout(cv::Size frameSize, int64_t durMs);
+    void renderKnob();
+    void drawLabel(std::string_view text, int x);
+    void setClock(std::string_view text);
+    void moveFill(int fillX);
+    void repaint(cv::Rect dirty);
+    cv::Rect knobRect(int x) const;
+};
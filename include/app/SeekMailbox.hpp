@@ -0,0 +1,55 @@
+#pragma once
+
+#include "video/FrameSource.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+// Single-slot, latest-wins seek request. Input handlers post as often as
+// they like; the playback loop takes whatever is there once per frame, so
+// a burst of targets costs one seek and the ones in between are dropped.
+// Lock-free, and safe to post from any thread.
+class SeekMailbox {
+public:
+    struct Request {
+        int64_t t_ms = 0;
+        SeekMode mode = SeekMode::Exact;
+    };
+
+    void post(int64_t t_ms, SeekMode mode) {
+        if (slot_.exchange(encode(t_ms, mode), std::memory_order_acq_rel) != kEmpty)
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::optional<Request> take() {
+        return decode(slot_.exchange(kEmpty, std::memory_order_acq_rel));
+    }
+
+    // The target waiting to be taken, without taking it.
+    std::optional<Request> pending() const {
+        return decode(slot_.load(std::memory_order_acquire));
+    }
+
+    // Requests overwritten before they were taken.
+    uint64_t coalesced() const { return coalesced_.load(std::memory_order_relaxed); }
+
+private:
+    // One word: the target in the high bits, the mode in bit 0, offset by
+    // one so that zero means empty.
+    static constexpr uint64_t kEmpty = 0;
+
+    static uint64_t encode(int64_t t_ms, SeekMode mode) {
+        const uint64_t t = static_cast<uint64_t>(t_ms < 0 ? 0 : t_ms);
+        return ((t << 1) | (mode == SeekMode::Keyframe ? 1u : 0u)) + 1;
+    }
+
+    static std::optional<Request> decode(uint64_t v) {
+        if (v == kEmpty) return std::nullopt;
+        --v;
+        return Request{static_cast<int64_t>(v >> 1), (v & 1) ? SeekMode::Keyframe : SeekMode::Exact};
+    }
+
+    std::atomic<uint64_t> slot_{kEmpty};
+    std::atomic<uint64_t> coalesced_{0};
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+// In-place pixel kernels for CV_8UC3 frames. None of them allocate.
+
+// roi = roi * keep, rounded exactly like
+// cv::addWeighted(black, 1 - keep, roi, keep, 0, roi). Works on any CV_8U
+// image; large ROIs are split over rows across threads.
+void darkenInPlace(cv::Mat& roi, double keep);
+
+// Instruction sets darkenInPlace can use; the best one the CPU supports is
+// picked at runtime.
+enum class KernelIsa { Scalar, Sse2, Avx2 };
+
+KernelIsa bestKernelIsa();
+const char* kernelIsaName(KernelIsa isa);
+
+// darkenInPlace on one thread with a given instruction set, for
+// verification and benchmarks. An unsupported set falls back to the next
+// one down: AVX2 to SSE2, SSE2 to scalar.
+void darkenInPlaceWith(KernelIsa isa, cv::Mat& roi, double keep);
+
+// Composites a retained layer stored in the frame's own layout: `color` is
+// premultiplied and `keep` holds 255 - alpha for every byte, so each byte
+// becomes frame * keep / 255 + color. Top-left at `at`, clipped to the frame;
+// wide layers are split over rows across threads.
+void compositeLayer(cv::Mat& frame, const cv::Mat& color, const cv::Mat& keep, cv::Point at);
+
+// compositeLayer on one thread with a given instruction set.
+void compositeLayerWith(KernelIsa isa, cv::Mat& frame, const cv::Mat& color, const cv::Mat& keep, cv::Point at);
+
+// Composites premultiplied colour plus alpha with its top-left at `at`,
+// clipped to the frame.
+void blitPremultiplied(cv::Mat& frame, const cv::Mat& bgr, const cv::Mat& alpha, cv::Point at);
+
+// Composites a solid colour through a CV_8UC1 coverage mask.
+void blendSolid(cv::Mat& frame, const cv::Mat& alpha, cv::Point at, const cv::Scalar& color);
+
+// Turns the same black-and-white artwork drawn over black and over white
+// (CV_8UC1 each) into premultiplied BGR and alpha.
+void matteToPremultiplied(const cv::Mat& onBlack, const cv::Mat& onWhite,
+                          cv::Mat& bgr, cv::Mat& alpha);
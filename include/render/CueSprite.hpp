@@ -0,0 +1,21 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstddef>
+
+// A cue block rasterized once at a given frame width: premultiplied BGR plus
+// an alpha mask, composited onto frames with a single blit.
+struct CueSprite {
+    cv::Mat bgr;    // CV_8UC3, premultiplied by alpha
+    cv::Mat alpha;  // CV_8UC1
+
+    int x = 0;             // left edge in frame coordinates
+    int top = 0;           // offset of the sprite's first row from the block top
+    int layoutHeight = 0;  // height used to anchor the block above the bottom margin
+    int advance = 0;       // vertical space the block takes when cues are stacked
+
+    bool empty() const { return alpha.empty(); }
+
+    size_t bytes() const { return bgr.total() * bgr.elemSize() + alpha.total() * alpha.elemSize(); }
+};
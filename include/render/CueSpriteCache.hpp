@@ -0,0 +1,78 @@
+#pragma once
+
+#include "render/CueSprite.hpp"
+#include "render/RenderStyle.hpp"
+#include "subs/CueBuffer.hpp"
+#include "subs/CueView.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// LRU cache of rasterized cues keyed by (cue, frame width, style), bounded by
+// a byte budget. A worker thread pre-renders cues that are about to start.
+class CueSpriteCache {
+public:
+    using Rasterizer = std::function<CueSprite(const CueView&, int frameWidth, const RenderStyle&)>;
+
+    CueSpriteCache(size_t budgetBytes, Rasterizer rasterize);
+    ~CueSpriteCache();
+
+    CueSpriteCache(const CueSpriteCache&) = delete;
+    CueSpriteCache& operator=(const CueSpriteCache&) = delete;
+
+    // Returns the cached sprite, rasterizing it on the calling thread on a miss.
+    std::shared_ptr<const CueSprite> get(const CueView& cue, int frameWidth, const RenderStyle& style);
+
+    // Replaces the pending pre-render queue with the given cues.
+    void prefetch(CueRange cues, int frameWidth, const RenderStyle& style);
+
+    size_t bytes() const;
+
+private:
+    // Cues are identified by their text address, which is unique and
+    // stable per track.
+    struct Key {
+        CueView cue;
+        int frameWidth = 0;
+        RenderStyle style;
+
+        bool operator==(const Key& o) const {
+            return cue.text.data() == o.cue.text.data() && frameWidth == o.frameWidth &&
+                   style == o.style;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& k) const noexcept;
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<const CueSprite> sprite;
+    };
+
+    const size_t budgetBytes_;
+    const Rasterizer rasterize_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+
+    std::list<Entry> lru_;  // front is most recently used
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    size_t bytes_ = 0;
+
+    std::deque<Key> pending_;
+    bool stop_ = false;
+    std::thread worker_;
+
+    std::shared_ptr<const CueSprite> findLocked(const Key& key);
+    void insertLocked(const Key& key, std::shared_ptr<const CueSprite> sprite);
+    void workerLoop();
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+// Per-byte Hershey glyph advances for one (font, scale, thickness).
+//
+// cv::getTextSize sums integer glyph advances times the scale left to right
+// and rounds once at the end. Summing the same doubles in the same order
+// reproduces its width exactly for fonts that map every byte to one glyph
+// (all Hershey faces except the Cyrillic path of FONT_HERSHEY_COMPLEX).
+class GlyphAdvanceTable {
+public:
+    // Tables are built once per key and shared by every renderer.
+    static const GlyphAdvanceTable& get(int fontFace, double fontScale, int thickness);
+
+    double advance(unsigned char c) const { return advance_[c]; }
+
+    // Pixel width of a run whose advances add up to sum.
+    int widthOf(double sum) const;
+
+    int textWidth(std::string_view text) const;
+
+private:
+    GlyphAdvanceTable(int fontFace, double fontScale, int thickness);
+
+    std::array<double, 256> advance_{};
+    int thickness_ = 0;
+};
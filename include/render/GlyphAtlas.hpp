@@ -0,0 +1,83 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Subtitle glyphs rasterized once into an atlas: channel 0 is the glyph's
+// coverage, channel 1 the same coverage dilated into the outline. Text is
+// decoded as UTF-8 and composited by blitting atlas cells, all outlines of
+// a run first and then all fills, as two putText passes would.
+//
+// The font is OpenCV's built-in Hershey set: FONT_HERSHEY_SIMPLEX for
+// ASCII and the Cyrillic glyphs of FONT_HERSHEY_COMPLEX for U+0410-U+044F.
+// A few common typographic characters fall back to ASCII look-alikes and
+// anything else is drawn as '?'. Widths match cv::getTextSize for ASCII;
+// glyphs land on whole pixels, so edges may differ from putText by a
+// subpixel.
+class GlyphAtlas {
+public:
+    struct Glyph {
+        double advance = 0.0;
+        cv::Rect cell;  // in the atlas; the pen sits at (pad, pad + ascent)
+        bool blank = false;
+    };
+
+    // Atlases are built once per key and shared by every renderer.
+    static const GlyphAtlas& get(double fontScale, int thickness, int outlinePx);
+
+    // Calls fn(const Glyph&) for every glyph `text` is drawn with.
+    template <class Fn>
+    void forEachGlyph(std::string_view text, Fn&& fn) const {
+        size_t i = 0;
+        while (i < text.size()) {
+            const Lookup l = lookup(decode(text, i));
+            for (uint8_t k = 0; k < l.count; ++k) fn(glyphs_[l.first + k]);
+        }
+    }
+
+    // Pixel width of a run whose advances add up to sum, as getTextSize.
+    int widthOf(double sum) const { return cvRound(sum + thickness_); }
+
+    int textWidth(std::string_view text) const;
+
+    // Height above the baseline and below it, as getTextSize reports them.
+    int height() const { return height_; }
+    int baseline() const { return baseline_; }
+
+    // Blends the run's outline (black) and then its fill (white) into a
+    // premultiplied grey plane and its alpha, both CV_8UC1. org is the
+    // baseline origin, as in cv::putText.
+    void draw(cv::Mat& lum, cv::Mat& alpha, std::string_view text, cv::Point org) const;
+
+private:
+    GlyphAtlas(double fontScale, int thickness, int outlinePx);
+
+    struct Lookup {
+        uint16_t first = 0;
+        uint8_t count = 0;
+    };
+
+    static char32_t decode(std::string_view text, size_t& i);
+    Lookup lookup(char32_t cp) const;
+
+    Lookup add(int fontFace, std::string_view utf8, double fontScale, int outlinePx, std::vector<cv::Mat>& cells);
+    Lookup alias(std::string_view ascii);
+
+    int thickness_ = 0;
+    int pad_ = 0;
+    int ascent_ = 0;
+    int cellHeight_ = 0;
+    int height_ = 0;
+    int baseline_ = 0;
+
+    cv::Mat atlas_;  // CV_8UC2: fill, outline
+    std::vector<Glyph> glyphs_;
+    std::array<Lookup, 128> ascii_{};
+    std::array<Lookup, 64> cyrillic_{};  // U+0410..U+044F
+    std::vector<std::pair<char32_t, Lookup>> aliases_;  // sorted by codepoint
+    Lookup unknown_;
+};
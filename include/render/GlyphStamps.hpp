@@ -0,0 +1,32 @@
+#pragma once
+
+#include "render/GlyphAdvanceTable.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <array>
+#include <string_view>
+
+// Hershey glyphs rasterized once into coverage masks, so overlay text that
+// changes every frame (clock, HUD) is composited without cv::putText, which
+// allocates on every call. Metrics match cv::putText/getTextSize; glyphs
+// land on whole pixels, so edges may differ from putText by a subpixel.
+class GlyphStamps {
+public:
+    GlyphStamps(int fontFace, double fontScale, int thickness);
+
+    double fontScale() const { return fontScale_; }
+
+    int textWidth(std::string_view text) const { return advances_.textWidth(text); }
+
+    // org is the baseline origin, as in cv::putText.
+    void draw(cv::Mat& frame, std::string_view text, cv::Point org, const cv::Scalar& color) const;
+
+private:
+    const GlyphAdvanceTable& advances_;
+    double fontScale_ = 1.0;
+
+    int pad_ = 0;
+    int ascent_ = 0;
+    std::array<cv::Mat, 256> stamps_;
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+
 struct RenderStyle {
     double fontScale = 1.0;
     int thickness = 2;
@@ -12,4 +15,17 @@ struct RenderStyle {
     double boxAlpha = 0.35; 
     int reservedBottomPx = 0;
 
+    // The same look for a frame k times the size it was tuned for.
+    RenderStyle scaled(double k) const {
+        RenderStyle s = *this;
+        s.fontScale = fontScale * k;
+        s.thickness = std::max(1, static_cast<int>(std::lround(thickness * k)));
+        s.outlineThickness = std::max(s.thickness + 1, static_cast<int>(std::lround(outlineThickness * k)));
+        s.marginPx = static_cast<int>(std::lround(marginPx * k));
+        s.lineSpacingPx = static_cast<int>(std::lround(lineSpacingPx * k));
+        s.reservedBottomPx = static_cast<int>(std::lround(reservedBottomPx * k));
+        return s;
+    }
+
+    bool operator==(const RenderStyle&) const = default;
 };
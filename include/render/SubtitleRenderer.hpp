@@ -1,27 +1,62 @@
 #pragma once
 
+#include "render/CueSprite.hpp"
+#include "render/CueSpriteCache.hpp"
 #include "render/RenderStyle.hpp"
-#include "subs/SubtitleCue.hpp"
+#include "subs/CueBuffer.hpp"
+#include "subs/CueView.hpp"
 
 #include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
 class SubtitleRenderer {
 public:
-    explicit SubtitleRenderer(RenderStyle style = {});
+    explicit SubtitleRenderer(RenderStyle style = {},
+                              size_t spriteBudgetBytes = 64u << 20);
 
-    void draw(cv::Mat& frame, const SubtitleCue& cue) const;
+    void draw(cv::Mat& frame, const CueView& cue) const;
+
+    // Overlapping cues are stacked in the given order, first one on top.
+    void draw(cv::Mat& frame, std::span<const CueView> cues) const;
+
+    // Draws for frames k times the size the style was set for, e.g. 0.5
+    // when a 4K source is composited at 1080p.
+    void setScale(double k);
+
+    // Hints the cues that start next so their sprites are ready in time.
+    void prefetch(CueRange upcoming, int frameWidth) const;
+
+    static CueSprite rasterize(const RenderStyle& style,
+                               const CueView& cue,
+                               int frameWidth);
+
+    // Padding between a line's text and the edge of its box.
+    static constexpr int kBoxPadX = 18;
+    static constexpr int kBoxPadY = 4;
 
 private:
+    RenderStyle baseStyle_;
     RenderStyle style_;
+    double scale_ = 1.0;
+
+    std::unique_ptr<CueSpriteCache> cache_;
+    mutable std::vector<std::shared_ptr<const CueSprite>> frameSprites_;
+    mutable const char* lastPrefetch_ = nullptr;
+    mutable int lastPrefetchWidth_ = 0;
 
-    static void drawOutlinedText(cv::Mat& frame,
-                                 const std::string& text,
-                                 cv::Point org,
-                                 double scale,
-                                 int thickness);
+    static void wrapLines(const RenderStyle& style,
+                          const CueView& cue,
+                          int maxWidthPx,
+                          std::vector<std::string>& result);
 
-    std::vector<std::string> wrapLines(const std::vector<std::string>& lines,
-                                       int maxWidthPx) const;
+#ifdef SUBPLAYER_VERIFY_WRAP
+    static void wrapLinesReference(const RenderStyle& style,
+                                   const CueView& cue,
+                                   int maxWidthPx,
+                                   std::vector<std::string>& result);
+#endif
 };
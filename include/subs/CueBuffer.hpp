@@ -0,0 +1,111 @@
+#pragma once
+
+#include "subs/CueView.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Read-only columns of a cue table, owned by a CueBuffer or mapped straight
+// from a compiled cache file.
+struct CueColumns {
+    std::span<const int64_t> start;
+    std::span<const int64_t> end;
+    std::span<const uint64_t> textBegin;  // size() + 1 entries
+    const char* text = nullptr;
+
+    size_t size() const noexcept { return start.size(); }
+
+    CueView operator[](size_t i) const noexcept {
+        return {start[i], end[i],
+                std::string_view(text + textBegin[i], textBegin[i + 1] - textBegin[i])};
+    }
+};
+
+// Cues stored structure-of-arrays: timings in parallel arrays that searches
+// can scan without touching text, and all text in one arena addressed by
+// offset. This is what the parser fills and SubtitleTrack takes over.
+class CueBuffer {
+public:
+    CueBuffer() = default;
+
+    // Appends a line to the cue being built.
+    void addLine(std::string_view line);
+
+    // Closes the cue being built. A cue without lines is dropped.
+    bool commit(int64_t start_ms, int64_t end_ms);
+
+    // Copies finished cues in; not while one is being built.
+    void append(const CueView& cue);
+    void append(const CueBuffer& other);
+
+    void reserve(size_t cues, size_t textBytes);
+
+    size_t size() const noexcept { return start_.size(); }
+    bool empty() const noexcept { return start_.empty(); }
+
+    int64_t startMs(size_t i) const noexcept { return start_[i]; }
+    int64_t endMs(size_t i) const noexcept { return end_[i]; }
+
+    CueView operator[](size_t i) const noexcept { return columns()[i]; }
+
+    CueColumns columns() const noexcept { return {start_, end_, textBegin_, text_.data()}; }
+
+    // Heap bytes held, for memory reporting.
+    size_t bytes() const noexcept;
+
+private:
+    friend class SubtitleTrack;
+
+    std::vector<int64_t> start_;
+    std::vector<int64_t> end_;
+    std::vector<uint64_t> textBegin_{0};  // cue i is [textBegin_[i], textBegin_[i + 1])
+    std::vector<char> text_;  // not std::string: moves must keep views valid
+    bool pendingLines_ = false;
+};
+
+// A run of consecutive cues of one table, iterated as CueViews.
+class CueRange {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = CueView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = CueView;
+
+        iterator() = default;
+        iterator(const CueColumns* cols, size_t i) : cols_(cols), i_(i) {}
+
+        CueView operator*() const { return (*cols_)[i_]; }
+        iterator& operator++() { ++i_; return *this; }
+        iterator operator++(int) { iterator t = *this; ++i_; return t; }
+        bool operator==(const iterator& o) const { return i_ == o.i_; }
+
+    private:
+        const CueColumns* cols_ = nullptr;
+        size_t i_ = 0;
+    };
+
+    CueRange() = default;
+    CueRange(CueColumns cols, size_t first, size_t last) : cols_(cols), first_(first), last_(last) {}
+
+    size_t size() const noexcept { return last_ - first_; }
+    bool empty() const noexcept { return first_ == last_; }
+
+    CueView operator[](size_t i) const { return cols_[first_ + i]; }
+    CueView front() const { return cols_[first_]; }
+    CueView back() const { return cols_[last_ - 1]; }
+
+    iterator begin() const { return {&cols_, first_}; }
+    iterator end() const { return {&cols_, last_}; }
+
+private:
+    CueColumns cols_;
+    size_t first_ = 0;
+    size_t last_ = 0;
+};
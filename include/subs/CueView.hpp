@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Non-owning view of one cue. The text lives in the owning track's arena
+// and stays put for the track's lifetime, so text.data() doubles as the
+// cue's identity.
+struct CueView {
+    int64_t start_ms = 0;
+    int64_t end_ms = 0;
+    std::string_view text;  // lines joined with '\n'
+
+    template <class Fn>
+    void forEachLine(Fn&& fn) const {
+        std::string_view rest = text;
+        while (!rest.empty()) {
+            const size_t nl = rest.find('\n');
+            fn(rest.substr(0, nl));
+            if (nl == std::string_view::npos) break;
+            rest.remove_prefix(nl + 1);
+        }
+    }
+};
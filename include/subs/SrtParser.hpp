@@ -2,14 +2,79 @@
 
 #include "subs/SubtitleTrack.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 
 class SrtParser {
 public:
+    // Malformed input. line() is 1-based and counts from the start of the
+    // file, whichever thread hit the error.
+    class ParseError : public std::runtime_error {
+    public:
+        ParseError(size_t line, const std::string& reason)
+            : std::runtime_error("line " + std::to_string(line) + ": " + reason), line_(line) {}
+
+        size_t line() const noexcept { return line_; }
+
+    private:
+        size_t line_;
+    };
+
+    // threads: 0 uses every hardware thread on large inputs, 1 always parses
+    // sequentially. The result is the same either way.
+    explicit SrtParser(unsigned threads = 0) : threads_(threads) {}
+
+    // Memory-maps the file and scans it in place; allocates only for cue text.
     SubtitleTrack parseFile(const std::filesystem::path& path) const;
 
+    // Original std::getline based parser, kept as a reference implementation.
+    // Throws the same ParseError, with the same line, as parseFile.
+    SubtitleTrack parseFileStream(const std::filesystem::path& path) const;
+
+    // Uses the compiled cache next to the file when it is current, otherwise
+    // parses and refreshes it.
+    SubtitleTrack parseFileCached(const std::filesystem::path& path) const;
+
+    SubtitleTrack parseBuffer(std::string_view data) const;
+
+    // Parses cues starting at byte `offset` (a cue boundary) until `maxCues`
+    // have been appended to `out` or the data ends. Returns the offset to
+    // resume from.
+    size_t parseCues(std::string_view data, size_t offset, size_t maxCues,
+                     CueBuffer& out) const;
+
+    // Coarse seek: bisects the file on byte offsets, reading one timeline
+    // per probe, and returns the start of a cue that begins at or before
+    // t_ms (0 if none does). Within kProbeGranularity bytes of the best one.
+    size_t cueOffsetBefore(std::string_view data, int64_t t_ms) const;
+
+    static constexpr size_t kProbeGranularity = 64u << 10;
+
+    // Below this, splitting costs more than it saves.
+    static constexpr size_t kParallelMinBytes = 4u << 20;
+
 private:
+    unsigned threads_;
+
+    // Splits at cue boundaries, parses the ranges on a pool and concatenates
+    // them in file order.
+    SubtitleTrack parseParallel(std::string_view data, unsigned threads) const;
+
+    // parseCues that also stops before the first cue starting at or past
+    // `stopAt`, returning that cue's offset.
+    size_t parseRange(std::string_view data, size_t offset, size_t stopAt, size_t maxCues,
+                      CueBuffer& out) const;
+
+    [[noreturn]] static void fail(std::string_view data, size_t lineAt, const std::string& reason);
+
+    // First cue starting at or after byte `from`: its offset and start time.
+    static bool nextCueAt(std::string_view data, size_t from, size_t& offset, int64_t& startMs);
+
     static int64_t parseTimeMs(std::string_view s);
     static std::string trim(std::string s);
+    static std::string_view trimView(std::string_view s);
 };
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+// Looks next to the video for <stem>.srt, <stem>.en.srt, <stem>.ru.srt,
+// in that order.
+std::optional<std::filesystem::path>
+autoFindSubtitles(const std::filesystem::path& videoPath);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "subs/CueView.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Inverted word index over cue text. Words are split at anything that is
+// not a letter or digit, lowercased (ASCII, Latin-1 and Cyrillic) and ё is
+// folded into е. Each word maps to the sorted ids of the cues containing it,
+// with ids given in start order, so a query is one binary search per word
+// plus an intersection of the lists. Words found in more than 1/32 of the
+// cues also keep a bitset: the shortest list is filtered by bit tests and
+// galloping, and queries made only of such words AND the bitsets.
+class SubtitleSearchIndex {
+public:
+    // Indexes `cues`, whose text must stay alive as long as the index;
+    // `owner` is held for that purpose and may be null.
+    explicit SubtitleSearchIndex(std::vector<CueView> cues, std::shared_ptr<const void> owner = nullptr);
+
+    // Ids of the cues containing every word of `query`, in any order, as
+    // whole words. Empty if the query has no words. The span points into
+    // the index or into `out`, which is only grown, never cleared, so a
+    // buffer reused across queries is not refilled each time.
+    std::span<const uint32_t> find(std::string_view query, std::vector<uint32_t>& out) const;
+
+    const CueView& cue(uint32_t id) const { return cues_[id]; }
+
+    size_t size() const noexcept { return cues_.size(); }
+    size_t words() const noexcept { return postBegin_.size() - 1; }
+
+    // Heap bytes held, for memory reporting.
+    size_t bytes() const noexcept;
+
+private:
+    std::shared_ptr<const void> owner_;
+    std::vector<CueView> cues_;  // by start
+
+    // Words sorted bytewise, all in one arena; word k is
+    // [wordBegin_[k], wordBegin_[k + 1]) and its cues are
+    // postings_[postBegin_[k], postBegin_[k + 1]).
+    std::vector<char> words_;
+    std::vector<uint32_t> wordBegin_{0};
+    std::vector<uint32_t> postBegin_{0};
+    std::vector<uint32_t> postings_;
+
+    // One bit per cue for dense words, kNoBits for the rest; a word's set is
+    // bits_[denseOf_[k] * bitWords_, +bitWords_).
+    static constexpr uint32_t kNoBits = UINT32_MAX;
+    size_t bitWords_ = 0;
+    std::vector<uint32_t> denseOf_;
+    std::vector<uint64_t> bits_;
+
+    std::string_view word(size_t k) const noexcept {
+        return {words_.data() + wordBegin_[k], wordBegin_[k + 1] - wordBegin_[k]};
+    }
+    // Lookup result: the word's cues and, for dense words, its bitset.
+    struct Term {
+        std::span<const uint32_t> ids;
+        const uint64_t* bits = nullptr;
+    };
+    Term termOf(std::string_view w) const;
+};
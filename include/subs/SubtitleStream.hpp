@@ -0,0 +1,118 @@
+#pragma once
+
+#include "io/MappedFile.hpp"
+#include "subs/CueView.hpp"
+#include "subs/SubtitleTrack.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Immutable view of what a SubtitleStream has parsed so far. Chunks are
+// never merged or rebuilt, so cue views stay valid for as long as any
+// snapshot holding the chunk is alive.
+class SubtitleSnapshot {
+public:
+    struct Chunk {
+        std::shared_ptr<const SubtitleTrack> track;
+        size_t begin = 0;       // byte range of the source it was parsed from
+        size_t end = 0;
+        int64_t firstStart = 0;
+        int64_t lastStart = 0;
+        int64_t maxEnd = 0;
+    };
+
+    SubtitleSnapshot() = default;
+    SubtitleSnapshot(std::vector<Chunk> chunks, size_t sourceSize, bool complete,
+                     std::string error = {});
+
+    // Every parsed cue with start_ms <= t_ms < end_ms, ordered by start_ms.
+    std::span<const CueView> activeRange(int64_t t_ms, std::vector<CueView>& out) const;
+
+    // Up to maxCount cues with start_ms > t_ms from the chunk covering t_ms.
+    CueRange startingAfter(int64_t t_ms, size_t maxCount) const;
+
+    // True once every cue that could be active at t_ms has been parsed.
+    bool covers(int64_t t_ms) const;
+
+    // Also true after a parse error: nothing more will arrive, and error()
+    // says why the track stops short.
+    bool complete() const noexcept { return complete_; }
+    const std::string& error() const noexcept { return error_; }
+    size_t size() const noexcept { return cueCount_; }
+
+    // Calls fn(const CueView&) for every parsed cue, chunk by chunk.
+    template <class Fn>
+    void forEachCue(Fn&& fn) const {
+        for (const Chunk& c : chunks_) {
+            for (const CueView& cue : c.track->startingAfter(-1, c.track->size())) fn(cue);
+        }
+    }
+
+private:
+    std::vector<Chunk> chunks_;   // ordered by byte offset
+    // Time spans of byte-contiguous parsed runs; open-ended at either end of
+    // the file.
+    std::vector<std::pair<int64_t, int64_t>> covered_;
+    size_t cueCount_ = 0;
+    bool complete_ = false;
+    std::string error_;
+};
+
+// Parses an .srt on a background thread and publishes the cues in chunks,
+// so playback can start before the file is fully read. A seek beyond the
+// parsed prefix makes the parser jump ahead via SrtParser::cueOffsetBefore
+// and fill the skipped range afterwards. Once everything is parsed the
+// compiled cache is refreshed, so the next open skips all of this.
+class SubtitleStream {
+public:
+    explicit SubtitleStream(const std::filesystem::path& path);
+
+    // Wraps a track that is already loaded, e.g. from the compiled cache.
+    explicit SubtitleStream(SubtitleTrack track);
+    ~SubtitleStream();
+
+    SubtitleStream(const SubtitleStream&) = delete;
+    SubtitleStream& operator=(const SubtitleStream&) = delete;
+
+    std::shared_ptr<const SubtitleSnapshot> snapshot() const;
+
+    // Asks the parser to cover t_ms next. Cheap; call it every frame that
+    // lands outside the snapshot's coverage.
+    void prioritize(int64_t t_ms) noexcept { wantMs_.store(t_ms, std::memory_order_relaxed); }
+
+    static constexpr size_t kChunkCues = 2048;
+
+private:
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+
+    static constexpr int64_t kNoWant = INT64_MIN;
+
+    std::filesystem::path path_;
+    std::optional<MappedFile> file_;
+
+    mutable std::mutex mtx_;
+    std::shared_ptr<const SubtitleSnapshot> snapshot_;
+
+    std::atomic<int64_t> wantMs_{kNoWant};
+
+    std::jthread worker_;
+
+    void workerLoop(std::stop_token st);
+    void publish(std::vector<SubtitleSnapshot::Chunk> chunks, bool complete,
+                 std::string error = {});
+    void saveCache(const std::vector<SubtitleSnapshot::Chunk>& chunks) const;
+};
@@ -1,20 +1,93 @@
 #pragma once
 
-#include "subs/SubtitleCue.hpp"
+#include "subs/CueBuffer.hpp"
+#include "subs/CueView.hpp"
 
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 
+class MappedFile;
+
 class SubtitleTrack {
 public:
-    explicit SubtitleTrack(std::vector<SubtitleCue> cues);
+    explicit SubtitleTrack(CueBuffer cues);
+
+    // Loads the compiled cache next to `srt` if it still matches the file's
+    // size, modification time and content digest. The cues are used straight
+    // from the mapping.
+    static std::optional<SubtitleTrack> loadCache(const std::filesystem::path& srt);
+
+    // Best effort, like StreamIndex::save: media directories may be read-only.
+    bool saveCache(const std::filesystem::path& srt, bool withIndex = true) const;
+
+    static std::filesystem::path cacheFor(const std::filesystem::path& srt);
+
+    // Latest-starting cue among those active at t_ms.
+    std::optional<CueView> activeAt(int64_t t_ms) const;
 
-    const SubtitleCue* activeAt(int64_t t_ms) const;
+    // Every cue with start_ms <= t_ms < end_ms, ordered by start_ms.
+    // O(log n + k), never allocates; the span is valid until the next call.
+    std::span<const CueView> activeRange(int64_t t_ms) const;
+
+    // Same query into caller-owned storage, for concurrent readers. Reserve
+    // maxOverlap() entries up front to keep it allocation-free.
+    std::span<const CueView> activeRange(int64_t t_ms, std::vector<CueView>& out) const;
+
+    size_t maxOverlap() const noexcept { return maxOverlap_; }
+
+    // Up to maxCount cues with start_ms > t_ms, in start order.
+    CueRange startingAfter(int64_t t_ms, size_t maxCount) const;
 
     size_t size() const noexcept { return cues_.size(); }
 
+    // Bytes held by the cues and the index, heap or mapped.
+    size_t bytes() const noexcept;
+
 private:
-    std::vector<SubtitleCue> cues_;
-    mutable size_t hint_ = 0;
+    // Centered interval tree flattened into arrays. Each node owns the cues
+    // that contain its center, stored twice: ascending by start in byStart_
+    // and descending by end in byEnd_, both at [begin, begin + count).
+    // Plain data, so the cache can store it as is.
+    struct IntervalNode {
+        int64_t center = 0;
+        uint32_t left = kNoNode;
+        uint32_t right = kNoNode;
+        uint32_t begin = 0;
+        uint32_t count = 0;
+    };
+
+    // Arrays the track built itself; the spans below point into these or
+    // into a mapped cache file, and neither moves with the track.
+    struct Storage {
+        CueBuffer cues;
+        std::vector<IntervalNode> nodes;
+        std::vector<uint32_t> byStart;
+        std::vector<uint32_t> byEnd;
+    };
+
+    static constexpr uint32_t kNoNode = UINT32_MAX;
+
+    SubtitleTrack() = default;
+
+    std::shared_ptr<Storage> storage_;
+    std::shared_ptr<const MappedFile> mapping_;
+
+    CueColumns cues_;  // ordered by start; the text follows the same order
+
+    std::span<const IntervalNode> nodes_;
+    std::span<const uint32_t> byStart_;
+    std::span<const uint32_t> byEnd_;
+    uint32_t root_ = kNoNode;
+    size_t maxOverlap_ = 0;
+
+    mutable std::vector<CueView> active_;
+
+    void sortByStart();
+    void buildIndex();
+    uint32_t buildNode(std::vector<uint32_t>& ids);
 };
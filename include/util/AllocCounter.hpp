@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts heap allocations per thread through a replaced global operator new
+// and a wrapped default cv::MatAllocator, which sees the cv::Mat pixel
+// buffers operator new never does. Compiled in only with
+// SUBPLAYER_COUNT_ALLOCS; otherwise enabled() is false and the counter stays
+// at zero.
+namespace AllocCounter {
+
+bool enabled() noexcept;
+
+// Allocations made by the calling thread since it started.
+uint64_t thisThread() noexcept;
+
+}  // namespace AllocCounter
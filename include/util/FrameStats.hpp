@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Log-linear histogram over unsigned 64-bit samples: eight sub-buckets per
+// power of two, so any reported quantile is within 12.5% of the real value.
+// Recording is a handful of relaxed atomic adds; readers never block writers.
+class Histogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr size_t kSub = size_t{1} << kSubBits;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+    void record(uint64_t v) noexcept;
+
+    uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const noexcept { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+    double mean() const noexcept;
+
+    // Midpoint of the bucket holding quantile q in [0, 1]; 0 when empty.
+    uint64_t quantile(double q) const noexcept;
+
+    void reset() noexcept;
+
+    // {"count": .., "mean": .., "p50": .., ..., "buckets": [[upper, count], ...]},
+    // values divided by `unit` (e.g. 1000 to report nanoseconds as microseconds).
+    void writeJson(std::ostream& os, double unit) const;
+
+    static size_t bucketOf(uint64_t v) noexcept;
+    static uint64_t lowerBound(size_t bucket) noexcept;
+    static uint64_t upperBound(size_t bucket) noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Per-stage frame timings and frame counters for the playback loop. Off by
+// default; while off, StageClock does not even read the clock.
+class FrameStats {
+public:
+    enum Stage : size_t {
+        Read,
+        Subtitles,
+        Hud,
+        ProgressBar,
+        Show,
+        WaitKey,
+        StageCount
+    };
+
+    static const char* stageName(Stage s) noexcept;
+
+    bool enabled() const noexcept { return enabled_; }
+    void setEnabled(bool on) noexcept { enabled_ = on; }
+
+    void record(Stage s, uint64_t ns) noexcept { stages_[s].record(ns); }
+    void recordFrame(uint64_t ns, uint64_t allocations) noexcept;
+
+    // Signed: positive when the frame on screen is ahead of the media clock.
+    void recordDrift(int64_t ns) noexcept;
+
+    void addLate() noexcept { late_.fetch_add(1, std::memory_order_relaxed); }
+    void addDropped(uint64_t n = 1) noexcept { dropped_.fetch_add(n, std::memory_order_relaxed); }
+
+    const Histogram& stage(Stage s) const noexcept { return stages_[s]; }
+    const Histogram& frameTime() const noexcept { return frame_; }
+    const Histogram& allocations() const noexcept { return allocs_; }
+    const Histogram& drift() const noexcept { return drift_; }
+    int64_t lastDriftNs() const noexcept { return lastDrift_.load(std::memory_order_relaxed); }
+    uint64_t frames() const noexcept { return frame_.count(); }
+    uint64_t late() const noexcept { return late_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    void writeJson(std::ostream& os) const;
+
+private:
+    bool enabled_ = false;
+
+    std::array<Histogram, StageCount> stages_;
+    Histogram frame_;   // whole loop iteration, ns
+    Histogram allocs_;  // heap allocations per frame
+    Histogram drift_;   // |presented PTS - media clock|, ns
+    std::atomic<int64_t> lastDrift_{0};
+    std::atomic<uint64_t> late_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// Splits one loop iteration into consecutive stages: each mark() charges the
+// time since the previous mark to the named stage.
+class StageClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StageClock(FrameStats& stats) noexcept
+        : stats_(stats), on_(stats.enabled())
+    {
+        if (on_) start_ = last_ = Clock::now();
+    }
+
+    void mark(FrameStats::Stage s) noexcept {
+        if (!on_) return;
+        const Clock::time_point now = Clock::now();
+        stats_.record(s, static_cast<uint64_t>((now - last_).count()));
+        last_ = now;
+    }
+
+    bool on() const noexcept { return on_; }
+
+    // Nanoseconds since construction; 0 while stats are off.
+    uint64_t elapsedNs() const noexcept {
+        return on_ ? static_cast<uint64_t>((last_ - start_).count()) : 0;
+    }
+
+private:
+    FrameStats& stats_;
+    const bool on_;
+    Clock::time_point start_;
+    Clock::time_point last_;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+// Runs fn(ctx, begin, end) over chunks of [0, rows) on a small persistent
+// pool plus the calling thread, and returns when all rows are done. Nothing
+// is allocated per call, so it is safe inside allocation-free frame code.
+// If another caller is already using the pool, the rows run inline instead.
+void parallelRows(int rows, int chunkRows, void (*fn)(void* ctx, int begin, int end), void* ctx);
+
+template <class Body>
+void parallelRows(int rows, int chunkRows, Body& body) {
+    parallelRows(rows, chunkRows,
+                 [](void* ctx, int begin, int end) { (*static_cast<Body*>(ctx))(begin, end); },
+                 &body);
+}
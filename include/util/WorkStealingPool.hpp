@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers, each with its own deque. A worker takes its newest
+// task first and, when empty, steals the oldest task of another worker, so
+// jobs submitted from inside a job stay local while idle threads still help.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // From a worker the task goes on that worker's deque, otherwise round-robin.
+    // Tasks must not throw.
+    void submit(Task task);
+
+    // Blocks until every submitted task, including ones submitted meanwhile,
+    // has finished.
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(queues_.size()); }
+
+private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::atomic<size_t> next_{0};
+    std::atomic<bool> stop_{false};
+
+    // queued_ counts tasks sitting in deques, unfinished_ those not yet done.
+    // A deque's mutex is always taken before sleepMtx_.
+    std::mutex sleepMtx_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    size_t queued_ = 0;
+    size_t unfinished_ = 0;
+
+    bool tryTake(size_t self, Task& out);
+    void workerLoop(size_t self);
+};
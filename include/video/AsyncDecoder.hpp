@@ -0,0 +1,72 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Decodes ahead of playback on its own thread into a fixed ring of
+// preallocated frames. Owns the capture while running: nothing else may touch
+// it until the decoder is destroyed.
+class AsyncDecoder {
+public:
+    struct Stats {
+        size_t depth = 0;
+        size_t capacity = 0;
+        uint64_t producerStalls = 0;  // producer found the ring full
+        uint64_t underruns = 0;       // consumer found the ring empty
+    };
+
+    AsyncDecoder(cv::VideoCapture& cap, size_t capacity, cv::Size frameSize);
+    ~AsyncDecoder();
+
+    AsyncDecoder(const AsyncDecoder&) = delete;
+    AsyncDecoder& operator=(const AsyncDecoder&) = delete;
+
+    // Blocks until a frame is ready; false once the stream is exhausted.
+    // The frame buffer is swapped with the slot, so no pixels are copied.
+    bool pop(cv::Mat& frame, int64_t& timeMs);
+
+    // Drops everything decoded so far, lets `reposition` move the capture
+    // while the producer is parked, and resumes decoding from there.
+    void seek(const std::function<void(cv::VideoCapture&)>& reposition);
+
+    // Discards the next n frames: buffered ones are dropped, any remainder
+    // is grab()bed past without decoding. Returns how many were skipped.
+    size_t skip(size_t n);
+
+    Stats stats() const;
+
+private:
+    struct Slot {
+        cv::Mat frame;
+        int64_t timeMs = 0;
+    };
+
+    cv::VideoCapture& cap_;
+    std::vector<Slot> slots_;
+
+    // Lock order: capMtx_ before mtx_. capMtx_ serializes decoding with
+    // repositioning, mtx_ guards the ring indices and flags.
+    std::mutex capMtx_;
+    mutable std::mutex mtx_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+
+    size_t head_ = 0;
+    size_t count_ = 0;
+    bool eof_ = false;
+    bool stop_ = false;
+
+    uint64_t producerStalls_ = 0;
+    uint64_t underruns_ = 0;
+
+    std::thread thread_;
+
+    void produce();
+};
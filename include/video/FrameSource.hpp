@@ -0,0 +1,66 @@
+#pragma once
+
+#include "video/AsyncDecoder.hpp"
+#include "video/StreamInfo.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+enum class SeekMode {
+    Exact,     // the frame shown at the target time
+    Keyframe,  // the keyframe at or before it; nothing is decoded to get there
+};
+
+// Where PlayerApp gets its frames. A frame handed out by read() may be a
+// view of memory the source owns (a mapped file, a pattern pool): treat it
+// as read-only, valid until the next call.
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    virtual bool read(cv::Mat& frame) = 0;
+
+    // Timestamp of the frame last read, or of the seek target after a seek.
+    virtual int64_t timeMs() const = 0;
+
+    // Advances past n frames without retrieving them; returns how many were
+    // actually skipped (fewer at the end of the stream).
+    virtual size_t skipFrames(size_t n) = 0;
+
+    virtual void seekMs(int64_t t_ms, SeekMode mode = SeekMode::Exact) = 0;
+
+    virtual const StreamInfo& info() const noexcept = 0;
+
+    virtual bool isAsync() const noexcept { return false; }
+    virtual AsyncDecoder::Stats asyncStats() const { return {}; }
+
+    double fps() const { return info().fps; }
+    cv::Size frameSize() const { return info().frameSize; }
+    int64_t durationMs() const { return info().durationMs; }
+};
+
+// A source whose frames are numbered and evenly spaced, so reading,
+// skipping and seeking are index arithmetic and every frame is a keyframe.
+// Subclasses only say how to produce frame i.
+class ConstantRateSource : public FrameSource {
+public:
+    bool read(cv::Mat& frame) override;
+    int64_t timeMs() const override { return lastMs_; }
+    size_t skipFrames(size_t n) override;
+    void seekMs(int64_t t_ms, SeekMode mode = SeekMode::Exact) override;
+    const StreamInfo& info() const noexcept override { return info_; }
+
+protected:
+    ConstantRateSource(cv::Size frameSize, double fps, int64_t frameCount);
+
+    virtual void frameAt(int64_t i, cv::Mat& frame) = 0;
+
+private:
+    StreamInfo info_;
+    int64_t next_ = 0;
+    int64_t lastMs_ = 0;
+
+    int64_t ptsOf(int64_t i) const;
+};
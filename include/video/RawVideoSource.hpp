@@ -0,0 +1,44 @@
+#pragma once
+
+#include "io/MappedFile.hpp"
+#include "video/FrameSource.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+// Uncompressed video read straight out of a memory-mapped file: YUV4MPEG2
+// (.y4m, 8-bit 4:2:0 or mono) or headerless packed BGR frames. BGR frames
+// are handed out as views of the mapping; Y4M frames cost one colour
+// conversion into the caller's buffer.
+class RawVideoSource : public ConstantRateSource {
+public:
+    // Y4M; size, rate and colour space come from the stream header. Throws
+    // on anything this reader does not handle.
+    static std::unique_ptr<RawVideoSource> openY4m(const std::filesystem::path& path);
+
+    // Packed BGR, frameSize.area() * 3 bytes per frame, back to back.
+    static std::unique_ptr<RawVideoSource> openBgr(const std::filesystem::path& path, cv::Size frameSize, double fps);
+
+private:
+    enum class Layout { Bgr, I420, Gray };
+
+    struct Format {
+        Layout layout = Layout::Bgr;
+        cv::Size size;
+        double fps = 0.0;
+        std::vector<size_t> offsets;  // of each frame's pixels in the file
+    };
+
+    RawVideoSource(MappedFile file, Format format);
+
+    MappedFile file_;
+    Layout layout_;
+    std::vector<size_t> offsets_;
+
+    void frameAt(int64_t i, cv::Mat& frame) override;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <stop_token>
+#include <vector>
+
+// Presentation timestamps of every frame plus keyframe positions, built by
+// one pass over the file and cached in a sidecar next to it.
+class StreamIndex {
+public:
+    // Demuxes the whole file. Returns nullopt if the pass was stopped or the
+    // file yielded no frames.
+    static std::optional<StreamIndex> build(const std::filesystem::path& video,
+                                            std::stop_token stop = {});
+
+    // Loads the sidecar if it exists and still matches the video's size and
+    // modification time.
+    static std::optional<StreamIndex> load(const std::filesystem::path& video);
+
+    // Best effort: media directories may well be read-only.
+    bool save(const std::filesystem::path& video) const;
+
+    static std::filesystem::path sidecarFor(const std::filesystem::path& video);
+
+    size_t frameCount() const noexcept { return ptsMs_.size(); }
+    bool hasKeyframes() const noexcept { return !keyframes_.empty(); }
+    size_t keyframeCount() const noexcept { return keyframes_.size(); }
+
+    int64_t ptsMs(size_t frame) const { return ptsMs_[frame]; }
+
+    // Last frame presented at or before t_ms (the first one if t_ms precedes it).
+    size_t frameAt(int64_t t_ms) const;
+
+    // Nearest keyframe at or before `frame`; `frame` itself without keyframe data.
+    size_t keyframeAtOrBefore(size_t frame) const;
+
+    int64_t durationMs() const;
+
+private:
+    std::vector<int64_t> ptsMs_;      // presentation order
+    std::vector<uint32_t> keyframes_;  // ascending frame numbers
+};
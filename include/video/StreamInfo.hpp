@@ -0,0 +1,12 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+
+struct StreamInfo {
+    double fps = 25.0;
+    cv::Size frameSize;
+    int64_t frameCount = 0;
+    int64_t durationMs = 0;
+};
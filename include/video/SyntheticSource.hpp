@@ -0,0 +1,23 @@
+#pragma once
+
+#include "video/FrameSource.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Generated frames of any size, rate and length, for measuring the
+// compositing pipeline without a decoder in the way. A small pool of
+// distinct patterns is rendered up front and handed out in turn as shared
+// views, so reading a frame costs nothing and every run sees the same
+// pixels.
+class SyntheticSource : public ConstantRateSource {
+public:
+    SyntheticSource(cv::Size frameSize, double fps, int64_t durationMs);
+
+private:
+    std::vector<cv::Mat> pool_;
+
+    void frameAt(int64_t i, cv::Mat& frame) override;
+};
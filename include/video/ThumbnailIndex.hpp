@@ -0,0 +1,59 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stop_token>
+#include <vector>
+
+// Small frames sampled at a fixed interval and packed back to back into one
+// BGR strip, for scrub previews. build() fills the strip in time order from
+// its own capture and publishes each thumbnail as it lands, so readers on
+// other threads can use the finished prefix while the rest is decoded.
+// Complete strips are cached in a sidecar next to the video.
+class ThumbnailIndex {
+public:
+    // An empty strip of `count` thumbnails, intervalMs apart from t = 0.
+    ThumbnailIndex(cv::Size thumbSize, int64_t intervalMs, size_t count);
+
+    // Spacing and size for a video of the given duration and frame size.
+    static std::shared_ptr<ThumbnailIndex> plan(int64_t durationMs, cv::Size frameSize);
+
+    // Decodes the samples. Returns false if stopped or the video cannot be
+    // opened; whatever was published stays usable. Running out of video
+    // before the last sample counts as done, since durations are estimates.
+    bool build(const std::filesystem::path& video, std::stop_token stop = {});
+
+    // Loads the sidecar if it exists and still matches the video's size and
+    // modification time.
+    static std::shared_ptr<ThumbnailIndex> load(const std::filesystem::path& video);
+
+    // Best effort; writes the thumbnails published so far. Call it once
+    // build() has returned true.
+    bool save(const std::filesystem::path& video) const;
+
+    static std::filesystem::path sidecarFor(const std::filesystem::path& video);
+
+    cv::Size thumbSize() const noexcept { return size_; }
+    int64_t intervalMs() const noexcept { return intervalMs_; }
+    size_t count() const noexcept { return count_; }
+    size_t ready() const noexcept { return ready_.load(std::memory_order_acquire); }
+
+    // The finished thumbnail nearest to t_ms as a view into the strip, or an
+    // empty Mat while none is ready.
+    cv::Mat nearest(int64_t t_ms) const;
+
+private:
+    cv::Size size_;
+    int64_t intervalMs_ = 0;
+    size_t count_ = 0;
+    std::vector<uint8_t> strip_;  // count_ thumbnails, each size_ in BGR
+    std::atomic<size_t> ready_{0};
+
+    size_t thumbBytes() const { return static_cast<size_t>(size_.area()) * 3; }
+    uint8_t* thumbData(size_t i) { return strip_.data() + i * thumbBytes(); }
+};
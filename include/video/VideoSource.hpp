@@ -1,24 +1,73 @@
 #pragma once
 
+#include "video/AsyncDecoder.hpp"
+#include "video/FrameSource.hpp"
+#include "video/StreamIndex.hpp"
+#include "video/StreamInfo.hpp"
+
 #include <opencv2/opencv.hpp>
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <thread>
 
-class VideoSource {
+// Frames decoded by cv::VideoCapture, optionally on a decode-ahead thread.
+class VideoSource : public FrameSource {
 public:
     explicit VideoSource(const std::filesystem::path& videoPath);
 
-    bool read(cv::Mat& frame);    
-    int64_t timeMs() const;         
-    void seekMs(int64_t t_ms);    
+    // Uses an index the caller already has instead of loading or building one.
+    VideoSource(const std::filesystem::path& videoPath,
+                std::shared_ptr<const StreamIndex> index);
+
+    // Moves decoding to a background thread that stays up to `capacity`
+    // frames ahead. Capacity 0 switches back to synchronous reads.
+    void startAsync(size_t capacity);
+    bool isAsync() const noexcept override { return async_ != nullptr; }
+    AsyncDecoder::Stats asyncStats() const override;
+
+    bool read(cv::Mat& frame) override;
+    int64_t timeMs() const override;
 
-    double fps() const;
-    cv::Size frameSize() const;
+    size_t skipFrames(size_t n) override;
 
-    int64_t durationMs() const;
+    // With a stream index this lands exactly on the frame shown at t_ms:
+    // jump to the preceding keyframe, then grab() forward without decoding
+    // to pixels. Keyframe mode stops at the keyframe, which makes scrubbing
+    // cheap. Without an index both fall back to CAP_PROP_POS_MSEC.
+    void seekMs(int64_t t_ms, SeekMode mode = SeekMode::Exact) override;
+
+    const StreamInfo& info() const noexcept override { return info_; }
+    bool hasIndex() const noexcept { return index_ != nullptr; }
 
 
 private:
-    cv::VideoCapture cap_;
+    struct PendingIndex {
+        std::atomic<bool> ready{false};
+        std::shared_ptr<const StreamIndex> index;  // published by `ready`
+    };
+
+    // Heap-allocated so the decoder's reference survives moves of VideoSource.
+    std::unique_ptr<cv::VideoCapture> cap_;
+    std::unique_ptr<AsyncDecoder> async_;
+
+    // Read once on open and refined by the index; the capture is off limits
+    // while async_ runs.
+    StreamInfo info_;
+
+    std::shared_ptr<const StreamIndex> index_;
+    std::shared_ptr<PendingIndex> pendingIndex_;
+
+    int64_t lastTimeMs_ = 0;
+
+    // Declared last so it is stopped and joined before anything it reports to.
+    std::jthread indexer_;
+
+    void open(const std::filesystem::path& videoPath);
+    void adoptIndex();
+    void useIndex(std::shared_ptr<const StreamIndex> index);
+    void positionCapture(cv::VideoCapture& cap, int64_t t_ms, SeekMode mode = SeekMode::Exact) const;
 };
@@ -0,0 +1,421 @@
+#include "app/BatchRunner.hpp"
+
+#include "app/BurnInExporter.hpp"
+#include "subs/SrtParser.hpp"
+#include "subs/SubtitleLocator.hpp"
+#include "util/WorkStealingPool.hpp"
+#include "video/StreamIndex.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// Admits jobs while their estimated footprint fits under the cap. A job
+// larger than the whole cap still runs, just alone.
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t cap) : cap_(cap) {}
+
+    size_t acquire(size_t bytes) {
+        if (cap_ == 0) return 0;
+        bytes = std::min(bytes, cap_);
+        std::unique_lock lk(mtx_);
+        freed_.wait(lk, [&] { return used_ + bytes <= cap_; });
+        used_ += bytes;
+        return bytes;
+    }
+
+    void release(size_t bytes) {
+        if (bytes == 0) return;
+        {
+            std::lock_guard lk(mtx_);
+            used_ -= bytes;
+        }
+        freed_.notify_all();
+    }
+
+private:
+    const size_t cap_;
+    size_t used_ = 0;
+    std::mutex mtx_;
+    std::condition_variable freed_;
+};
+
+constexpr const char* kManifestHeader = "# subplayer batch manifest v2";
+
+// Sprites are only kept for the handful of cues around the playhead; a batch
+// running many exports at once does not need the interactive budget.
+constexpr size_t kBatchSpriteBudget = 16u << 20;
+
+bool isVideo(const std::filesystem::path& p) {
+    static const std::set<std::string> kExts = {
+        ".mp4", ".mkv", ".avi", ".mov", ".webm", ".m4v", ".ts", ".mpg", ".mpeg",
+    };
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return kExts.count(ext) != 0;
+}
+
+bool isUnder(const std::filesystem::path& p, const std::filesystem::path& dir) {
+    const auto a = std::filesystem::weakly_canonical(p);
+    const auto b = std::filesystem::weakly_canonical(dir);
+    return std::mismatch(b.begin(), b.end(), a.begin(), a.end()).first == b.end();
+}
+
+std::filesystem::path outputFor(const std::filesystem::path& rel,
+                                const std::filesystem::path& outDir) {
+    std::filesystem::path out = outDir / rel;
+    out.replace_filename(rel.stem().string() + ".subbed" + rel.extension().string());
+    return out;
+}
+
+// Fields are tab-separated, so neither tabs nor line breaks may leak in.
+std::string oneLine(std::string s) {
+    for (char& c : s) {
+        if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+    }
+    return s;
+}
+
+// Size and mtime of an input, so a file replaced at the same path is told
+// apart on resume. "-" when the file cannot be read.
+std::string stampOf(const std::filesystem::path& p) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(p, ec);
+    if (ec) return "-";
+    const auto mtime = std::filesystem::last_write_time(p, ec);
+    if (ec) return "-";
+    return std::to_string(size) + ":" + std::to_string(mtime.time_since_epoch().count());
+}
+
+const char* stateName(BatchJob::State s) {
+    switch (s) {
+        case BatchJob::State::Done:   return "done";
+        case BatchJob::State::Failed: return "failed";
+        default:                      return "pending";
+    }
+}
+
+}  // namespace
+
+BatchRunner::BatchRunner(BatchOptions options)
+    : opt_(std::move(options))
+{
+    if (opt_.concurrency == 0) opt_.concurrency = std::max(1u, std::thread::hardware_concurrency());
+    if (opt_.jobsPerFile == 0) opt_.jobsPerFile = 1;
+}
+
+std::vector<BatchJob> BatchRunner::discover(const std::filesystem::path& input,
+                                            const std::filesystem::path& outDir,
+                                            BatchMode mode) {
+    namespace fs = std::filesystem;
+
+    std::vector<BatchJob> jobs;
+    auto add = [&](const fs::path& video, std::optional<fs::path> subs, const fs::path& rel) {
+        BatchJob job;
+        job.video = fs::absolute(video);
+        job.subs = subs ? std::optional<fs::path>(fs::absolute(*subs)) : autoFindSubtitles(job.video);
+        if (mode == BatchMode::BurnIn) job.output = fs::absolute(outputFor(rel, outDir));
+        jobs.push_back(std::move(job));
+    };
+
+    if (fs::is_directory(input)) {
+        for (const auto& e : fs::recursive_directory_iterator(
+                 input, fs::directory_options::skip_permission_denied)) {
+            if (!e.is_regular_file() || !isVideo(e.path())) continue;
+            // Outputs of this or an earlier run are not inputs.
+            if (isUnder(e.path(), outDir)) continue;
+            add(e.path(), std::nullopt, fs::relative(e.path(), input));
+        }
+        std::sort(jobs.begin(), jobs.end(),
+                  [](const BatchJob& a, const BatchJob& b) { return a.video < b.video; });
+        return jobs;
+    }
+
+    std::ifstream in(input);
+    if (!in) throw std::runtime_error("Cannot open batch list: " + input.string());
+
+    const fs::path base = input.parent_path();
+    std::set<fs::path> outputs;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        const size_t tab = line.find('\t');
+        const fs::path video = base / line.substr(0, tab);
+        std::optional<fs::path> subs;
+        if (tab != std::string::npos && tab + 1 < line.size()) subs = base / line.substr(tab + 1);
+
+        add(video, subs, video.filename());
+        if (mode == BatchMode::BurnIn && !outputs.insert(jobs.back().output).second) {
+            throw std::runtime_error("Batch list names two videos that map to " +
+                                     jobs.back().output.string());
+        }
+    }
+    return jobs;
+}
+
+std::filesystem::path BatchRunner::manifestPath() const {
+    return opt_.outDir / (opt_.mode == BatchMode::BurnIn ? "batch-burnin.tsv" : "batch-analyze.tsv");
+}
+
+void BatchRunner::resumeFromManifest() {
+    std::ifstream in(manifestPath());
+    if (!in) return;
+
+    struct Record {
+        int64_t frames = 0;
+        double seconds = 0.0;
+        std::string videoStamp;
+        std::string subs;
+        std::string subsStamp;
+        std::string note;
+    };
+    std::unordered_map<std::string, Record> done;
+
+    // A manifest from another version has no input stamps to trust.
+    std::string line;
+    if (!std::getline(in, line) || line != kManifestHeader) return;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> f;
+        std::istringstream ss(line);
+        for (std::string field; std::getline(ss, field, '\t');) f.push_back(std::move(field));
+        if (f.size() < 8 || f[0] != "done") continue;
+
+        Record r;
+        try {
+            r.frames = std::stoll(f[1]);
+            r.seconds = std::stod(f[2]);
+        } catch (const std::exception&) {
+            continue;
+        }
+        r.videoStamp = f[4];
+        r.subs = f[5];
+        r.subsStamp = f[6];
+        if (f.size() > 8) r.note = f[8];
+        done[f[3]] = std::move(r);
+    }
+
+    for (BatchJob& job : jobs_) {
+        auto it = done.find(job.video.string());
+        if (it == done.end()) continue;
+
+        // Redo the job if either input changed, even in place, or its output
+        // went missing.
+        const Record& r = it->second;
+        const std::string subs = job.subs ? job.subs->string() : "-";
+        const std::string videoStamp = stampOf(job.video);
+        const std::string subsStamp = job.subs ? stampOf(*job.subs) : "-";
+        if (r.subs != subs || r.videoStamp != videoStamp || r.subsStamp != subsStamp) continue;
+        if (videoStamp == "-" || (job.subs && subsStamp == "-")) continue;
+        if (!job.output.empty() && !std::filesystem::exists(job.output)) continue;
+
+        job.videoStamp = videoStamp;
+        job.subsStamp = subsStamp;
+        job.state = BatchJob::State::Done;
+        job.frames = r.frames;
+        job.seconds = r.seconds;
+        job.note = r.note;
+    }
+}
+
+void BatchRunner::saveManifest() const {
+    const std::filesystem::path target = manifestPath();
+    std::filesystem::path tmp = target;
+    tmp += ".tmp";
+
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << kManifestHeader << "\n"
+            << "# state\tframes\tseconds\tvideo\tvideo_stamp\tsubs\tsubs_stamp\toutput\tnote\n";
+        for (const BatchJob& job : jobs_) {
+            out << stateName(job.state) << '\t' << job.frames << '\t' << job.seconds << '\t'
+                << job.video.string() << '\t'
+                << (job.videoStamp.empty() ? "-" : job.videoStamp) << '\t'
+                << (job.subs ? job.subs->string() : "-") << '\t'
+                << (job.subsStamp.empty() ? "-" : job.subsStamp) << '\t'
+                << (job.output.empty() ? "-" : job.output.string()) << '\t'
+                << oneLine(job.note) << "\n";
+        }
+        if (!out) throw std::runtime_error("Cannot write batch manifest: " + tmp.string());
+    }
+
+    // Replace in one step so a kill never leaves a torn manifest behind.
+    std::filesystem::rename(tmp, target);
+}
+
+size_t BatchRunner::estimateBytes(const BatchJob& job) const {
+    std::error_code ec;
+    size_t bytes = 0;
+    if (job.subs) {
+        // Cue structs plus their strings, roughly four times the file.
+        const auto srtSize = std::filesystem::file_size(*job.subs, ec);
+        if (!ec) bytes += static_cast<size_t>(srtSize) * 4;
+    }
+
+    cv::VideoCapture probe(job.video.string());
+    const size_t frameBytes = probe.isOpened()
+        ? static_cast<size_t>(probe.get(cv::CAP_PROP_FRAME_WIDTH) *
+                              probe.get(cv::CAP_PROP_FRAME_HEIGHT) * 3)
+        : size_t{1920 * 1080 * 3};
+    const size_t frameCount = probe.isOpened()
+        ? static_cast<size_t>(std::max(0.0, probe.get(cv::CAP_PROP_FRAME_COUNT)))
+        : 0;
+
+    // Index: one timestamp per frame, with slack for the sort during build.
+    bytes += frameCount * 2 * sizeof(int64_t);
+
+    if (opt_.mode == BatchMode::Analyze) return bytes + 2 * frameBytes;
+
+    // Per segment: the decoded frame, encoder lookahead and the sprite cache.
+    constexpr size_t kFramesInFlight = 8;
+    return bytes + opt_.jobsPerFile * (kFramesInFlight * frameBytes + kBatchSpriteBudget);
+}
+
+void BatchRunner::execute(BatchJob& job) const {
+    // Stamped before reading, so an input edited mid-job is redone next time.
+    job.videoStamp = stampOf(job.video);
+    job.subsStamp = job.subs ? stampOf(*job.subs) : "-";
+
+    std::optional<SubtitleTrack> subs;
+    if (job.subs) {
+        SrtParser parser;
+        subs = parser.parseFileCached(*job.subs);
+    }
+
+    if (opt_.mode == BatchMode::Analyze) {
+        std::optional<StreamIndex> index = StreamIndex::load(job.video);
+        if (!index) {
+            index = StreamIndex::build(job.video);
+            if (!index) throw std::runtime_error("Cannot index " + job.video.string());
+            index->save(job.video);
+        }
+
+        char note[160];
+        std::snprintf(note, sizeof(note), "cues=%zu overlap=%zu keyframes=%zu duration_ms=%lld",
+                      subs ? subs->size() : size_t{0},
+                      subs ? subs->maxOverlap() : size_t{0},
+                      index->keyframeCount(),
+                      static_cast<long long>(index->durationMs()));
+        job.frames = static_cast<int64_t>(index->frameCount());
+        job.note = note;
+        return;
+    }
+
+    std::filesystem::create_directories(job.output.parent_path());
+
+    ExportOptions eo;
+    eo.input = job.video;
+    eo.output = job.output;
+    eo.jobs = opt_.jobsPerFile;
+    eo.fourcc = opt_.fourcc;
+    eo.style = opt_.style;
+    eo.spriteBudgetBytes = kBatchSpriteBudget;
+
+    const ExportReport r = BurnInExporter(eo).run(subs ? &*subs : nullptr);
+    job.frames = r.frames;
+    job.note = subs ? "cues=" + std::to_string(subs->size()) : "no subtitles";
+}
+
+BatchSummary BatchRunner::run() {
+    std::filesystem::create_directories(opt_.outDir);
+    jobs_ = discover(opt_.input, opt_.outDir, opt_.mode);
+    resumeFromManifest();
+
+    BatchSummary summary;
+    std::vector<BatchJob*> todo;
+    for (BatchJob& job : jobs_) {
+        if (job.state == BatchJob::State::Done) ++summary.skipped;
+        else todo.push_back(&job);
+    }
+
+    {
+        std::lock_guard lk(mtx_);
+        saveManifest();
+    }
+
+    std::cout << "batch: " << jobs_.size() << " videos, " << summary.skipped
+              << " already done, " << todo.size() << " to run on "
+              << opt_.concurrency << " threads\n";
+
+    // Longest first, so a big file picked up last does not stretch the run.
+    auto sizeOf = [](const BatchJob* j) {
+        std::error_code ec;
+        const auto s = std::filesystem::file_size(j->video, ec);
+        return ec ? uintmax_t{0} : s;
+    };
+    std::stable_sort(todo.begin(), todo.end(),
+                     [&](const BatchJob* a, const BatchJob* b) { return sizeOf(a) > sizeOf(b); });
+
+    const auto t0 = std::chrono::steady_clock::now();
+    MemoryBudget budget(opt_.memoryCapBytes);
+    size_t finished = 0;
+    {
+        WorkStealingPool pool(opt_.concurrency);
+        for (BatchJob* slot : todo) {
+            pool.submit([&, slot] {
+                // Work on a copy: the manifest may be written from another
+                // thread while this job runs.
+                BatchJob job = *slot;
+                size_t held = 0;
+                auto start = std::chrono::steady_clock::now();
+                try {
+                    held = budget.acquire(estimateBytes(job));
+                    start = std::chrono::steady_clock::now();
+                    execute(job);
+                    job.state = BatchJob::State::Done;
+                } catch (const std::exception& e) {
+                    job.state = BatchJob::State::Failed;
+                    job.note = e.what();
+                }
+                job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                budget.release(held);
+
+                std::lock_guard lk(mtx_);
+                *slot = job;
+                ++finished;
+
+                std::cout << "[" << finished << "/" << todo.size() << "] "
+                          << job.video.filename().string() << ": ";
+                if (job.state == BatchJob::State::Done) {
+                    summary.frames += job.frames;
+                    ++summary.done;
+                    std::cout << job.frames << " frames in " << job.seconds << " s ("
+                              << (job.seconds > 0.0 ? job.frames / job.seconds : 0.0) << " fps) "
+                              << job.note << "\n";
+                } else {
+                    ++summary.failed;
+                    std::cout << "FAILED: " << job.note << "\n";
+                }
+
+                try {
+                    saveManifest();
+                } catch (const std::exception& e) {
+                    std::cerr << "batch: " << e.what() << "\n";
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return summary;
+}
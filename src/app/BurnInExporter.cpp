@@ -0,0 +1,202 @@
+#include "app/BurnInExporter.hpp"
+
+#include "render/SubtitleRenderer.hpp"
+#include "video/VideoSource.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+static int fourccOf(const std::string& code) {
+    if (code.size() != 4) throw std::runtime_error("FOURCC must be 4 characters: " + code);
+    return cv::VideoWriter::fourcc(code[0], code[1], code[2], code[3]);
+}
+
+// Single-quotes a string for /bin/sh and for ffmpeg's concat list alike.
+static std::string quoted(const std::string& s) {
+    std::string out = "'";
+    for (char c : s) {
+        if (c == '\'') out += "'\\''";
+        else out += c;
+    }
+    out += "'";
+    return out;
+}
+
+static bool haveFfmpeg() {
+    return std::system("ffmpeg -version > /dev/null 2>&1") == 0;
+}
+
+BurnInExporter::BurnInExporter(ExportOptions options)
+    : opt_(std::move(options))
+{
+    if (opt_.jobs == 0) opt_.jobs = std::max(1u, std::thread::hardware_concurrency());
+}
+
+ExportReport BurnInExporter::run(const SubtitleTrack* subs) const {
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // Segments must meet exactly, which needs frame-accurate seeks.
+    std::shared_ptr<const StreamIndex> index;
+    if (auto idx = StreamIndex::load(opt_.input)) {
+        index = std::make_shared<const StreamIndex>(std::move(*idx));
+    } else if (auto built = StreamIndex::build(opt_.input)) {
+        built->save(opt_.input);
+        index = std::make_shared<const StreamIndex>(std::move(*built));
+    }
+
+    std::vector<Segment> segments;
+    const int64_t total = index ? static_cast<int64_t>(index->frameCount()) : -1;
+
+    if (!index) {
+        std::cerr << "export: no stream index, falling back to a single segment\n";
+        segments.push_back({});
+    } else {
+        // Short segments would spend more time seeking than encoding.
+        constexpr int64_t kMinSegmentFrames = 64;
+        const int64_t n = std::clamp<int64_t>(total / kMinSegmentFrames, 1, opt_.jobs);
+
+        for (int64_t i = 0; i < n; ++i) {
+            Segment seg;
+            seg.firstFrame = total * i / n;
+            seg.frameCount = total * (i + 1) / n - seg.firstFrame;
+            segments.push_back(seg);
+        }
+    }
+
+    for (size_t i = 0; i < segments.size(); ++i) {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".part%03zu.ts", i);
+        segments[i].path = opt_.output;
+        segments[i].path += suffix;
+    }
+
+    std::vector<std::exception_ptr> errors(segments.size());
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(segments.size());
+        for (size_t i = 0; i < segments.size(); ++i) {
+            workers.emplace_back([&, i] {
+                try {
+                    encodeSegment(segments[i], subs, index);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+    }
+
+    for (const auto& e : errors) {
+        if (e) std::rethrow_exception(e);
+    }
+
+    stitch(segments);
+
+    ExportReport report;
+    report.segments = static_cast<unsigned>(segments.size());
+    for (const Segment& seg : segments) report.frames += seg.written;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return report;
+}
+
+void BurnInExporter::encodeSegment(Segment& seg,
+                                   const SubtitleTrack* subs,
+                                   const std::shared_ptr<const StreamIndex>& index) const {
+    VideoSource video(opt_.input, index);
+    if (index && seg.firstFrame > 0) video.seekMs(index->ptsMs(static_cast<size_t>(seg.firstFrame)));
+
+    // Each part is MPEG-TS so parts can be joined without re-encoding.
+    cv::VideoWriter writer(seg.path.string(), fourccOf(opt_.fourcc),
+                           video.fps(), video.frameSize());
+    if (!writer.isOpened()) throw std::runtime_error("Cannot open writer: " + seg.path.string());
+
+    SubtitleRenderer renderer(opt_.style, opt_.spriteBudgetBytes);
+    std::vector<CueView> active;
+    if (subs) active.reserve(subs->maxOverlap());
+
+    cv::Mat frame;
+    while (seg.frameCount < 0 || seg.written < seg.frameCount) {
+        if (!video.read(frame) || frame.empty()) break;
+
+        if (subs) {
+            auto cues = subs->activeRange(video.timeMs(), active);
+            if (!cues.empty()) renderer.draw(frame, cues);
+            renderer.prefetch(subs->startingAfter(video.timeMs(), 3), frame.cols);
+        }
+
+        writer.write(frame);
+        ++seg.written;
+    }
+}
+
+void BurnInExporter::stitch(const std::vector<Segment>& segments) const {
+    auto removeParts = [&] {
+        std::error_code ec;
+        for (const Segment& seg : segments) std::filesystem::remove(seg.path, ec);
+    };
+
+    // Transport streams concatenate byte for byte.
+    if (opt_.output.extension() == ".ts") {
+        std::ofstream out(opt_.output, std::ios::binary | std::ios::trunc);
+        for (const Segment& seg : segments) {
+            std::ifstream in(seg.path, std::ios::binary);
+            out << in.rdbuf();
+        }
+        if (!out) throw std::runtime_error("Cannot write: " + opt_.output.string());
+        removeParts();
+        return;
+    }
+
+    // Other containers: remux with ffmpeg when present, which also carries
+    // the source audio over. OpenCV itself only writes video.
+    if (haveFfmpeg()) {
+        std::filesystem::path list = opt_.output;
+        list += ".parts.txt";
+        {
+            std::ofstream l(list);
+            for (const Segment& seg : segments) {
+                l << "file " << quoted(std::filesystem::absolute(seg.path).string()) << "\n";
+            }
+        }
+
+        const std::string cmd =
+            "ffmpeg -y -loglevel error -f concat -safe 0 -i " + quoted(list.string()) +
+            " -i " + quoted(opt_.input.string()) +
+            " -map 0:v -map 1:a? -c copy " + quoted(opt_.output.string());
+
+        const int rc = std::system(cmd.c_str());
+        std::error_code ec;
+        std::filesystem::remove(list, ec);
+        if (rc != 0) throw std::runtime_error("ffmpeg remux failed: " + cmd);
+
+        removeParts();
+        return;
+    }
+
+    // Last resort: decode the parts again and re-encode them in order.
+    std::cerr << "export: ffmpeg not found, re-encoding parts into "
+              << opt_.output.string() << "\n";
+
+    cv::VideoWriter writer;
+    cv::Mat frame;
+    for (const Segment& seg : segments) {
+        cv::VideoCapture in(seg.path.string());
+        while (in.read(frame)) {
+            if (!writer.isOpened()) {
+                writer.open(opt_.output.string(), fourccOf(opt_.fourcc),
+                            in.get(cv::CAP_PROP_FPS), frame.size());
+                if (!writer.isOpened()) throw std::runtime_error("Cannot open writer: " + opt_.output.string());
+            }
+            writer.write(frame);
+        }
+    }
+    removeParts();
+}
@@ -1,82 +1,139 @@
 #include "app/PlayerApp.hpp"
 
+#include "util/AllocCounter.hpp"
+
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui.hpp>
 
 
-#include <iomanip>
-
 #include <algorithm>
-#include <sstream>
-
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <string_view>
+
+
+static constexpr size_t kPrefetchCues = 3;
+static constexpr size_t kMaxActiveCues = 64;
+static constexpr int kAllocWarmupFrames = 30;
+static constexpr int kScaleSteps = 32;
+static constexpr int kThumbBorder = 2;
+static constexpr int kThumbGap = 6;
+static constexpr int kHudLineH = 30;
+static constexpr size_t kMaxQuery = 64;
+
+// Paused and idle, the loop only wakes to poll for input: quickly for a
+// second after the last key or mouse event, slowly after that.
+static constexpr int kActiveWaitMs = 15;
+static constexpr int kIdleWaitMs = 250;
+static constexpr std::chrono::seconds kInputActivity{1};
 
 void PlayerApp::onMouseThunk(int event, int x, int y, int flags, void* userdata) {
     auto* self = static_cast<PlayerApp*>(userdata);
     if (self) self->onMouse(event, x, y, flags);
 }
 
-void PlayerApp::seekByMouseX(int x) {
-    if (!bar_.valid || bar_.durMs <= 0) return;
+int64_t PlayerApp::timeAtX(int x) const {
+    const ProgressBarLayer::Geometry& bar = progressBar_.geometry();
 
-    if (x < bar_.x0) x = bar_.x0;
-    if (x > bar_.x1) x = bar_.x1;
+    x = std::clamp(x, bar.x0, bar.x1);
+    const double ratio = (bar.x1 == bar.x0) ? 0.0
+        : static_cast<double>(x - bar.x0) / static_cast<double>(bar.x1 - bar.x0);
 
-    double ratio = (bar_.x1 == bar_.x0) ? 0.0
-        : static_cast<double>(x - bar_.x0) / static_cast<double>(bar_.x1 - bar_.x0);
+    return static_cast<int64_t>(ratio * static_cast<double>(bar.durMs));
+}
 
-    int64_t t = static_cast<int64_t>(ratio * static_cast<double>(bar_.durMs));
+void PlayerApp::seekByMouseX(int x, SeekMode mode) {
+    const ProgressBarLayer::Geometry& bar = progressBar_.geometry();
+    if (!bar.valid || bar.durMs <= 0) return;
 
-    video_.seekMs(t);
-    needRefreshFrame_ = true;
+    seeks_.post(timeAtX(x), mode);
+}
 
+void PlayerApp::seekBy(int64_t deltaMs) {
+    // Relative to a seek still in the mailbox, so quick presses add up.
+    const auto pending = seeks_.pending();
+    seeks_.post((pending ? pending->t_ms : video_->timeMs()) + deltaMs, SeekMode::Exact);
 }
 
+void PlayerApp::applyPendingSeek() {
+    const auto req = seeks_.take();
+    if (!req) return;
+
+    video_->seekMs(req->t_ms, req->mode);
+    scheduler_.invalidate();
+    needRefreshFrame_ = true;
+}
 
-void PlayerApp::onMouse(int event, int x, int y, int flags) {
-    if (!bar_.valid) return;
 
-    cv::Rect imgRect = cv::getWindowImageRect("player");
-    if (imgRect.width <= 0 || imgRect.height <= 0) return;
+void PlayerApp::onMouse(int event, int x, int y, int flags) {
+    const ProgressBarLayer::Geometry& bar = progressBar_.geometry();
+    if (!bar.valid) return;
 
-    int xi = x - imgRect.x;
-    int yi = y - imgRect.y;
+    lastInput_ = PresentationScheduler::Clock::now();
+    const int hoverBefore = hoverX_;
+    handleBarMouse(event, x, y, bar);
+    if (hoverX_ != hoverBefore) dirty_ = true;
+}
 
-    if (xi < 0 || yi < 0 || xi >= imgRect.width || yi >= imgRect.height) {
-        if (event == cv::EVENT_LBUTTONUP) draggingBar_ = false;
+void PlayerApp::handleBarMouse(int event, int x, int y, const ProgressBarLayer::Geometry& bar) {
+    // Dragging moves the preview; the exact seek happens on release. With
+    // no thumbnail to show yet, the video follows the drag at keyframes.
+    if (draggingBar_) {
+        hoverX_ = std::clamp(x, bar.x0, bar.x1);
+        if (event == cv::EVENT_LBUTTONUP) {
+            draggingBar_ = false;
+            hoverX_ = -1;
+            seekByMouseX(x, SeekMode::Exact);
+        } else if (event == cv::EVENT_MOUSEMOVE && (!thumbs_ || thumbs_->ready() == 0)) {
+            seekByMouseX(x, SeekMode::Keyframe);
+        }
         return;
     }
 
-    if (bar_.frameW <= 0 || bar_.frameH <= 0) return;
-
-    int fx = static_cast<int>( (static_cast<double>(xi) / imgRect.width)  * bar_.frameW );
-    int fy = static_cast<int>( (static_cast<double>(yi) / imgRect.height) * bar_.frameH );
-
-    const bool inside = (fx >= bar_.x0 && fx <= bar_.x1 && fy >= bar_.y0 && fy <= bar_.y1);
+    // HighGUI reports positions in pixels of the image last shown, which is
+    // the composited frame the bar was laid out on.
+    const bool inside = (x >= bar.x0 && x <= bar.x1 && y >= bar.y0 && y <= bar.y1
+                         && x < bar.frameW && y < bar.frameH);
+    hoverX_ = inside ? x : -1;
 
-    if (event == cv::EVENT_LBUTTONDOWN && inside) {
-        draggingBar_ = true;
-        seekByMouseX(fx);
-    } else if (event == cv::EVENT_MOUSEMOVE && draggingBar_) {
-        seekByMouseX(fx);
-    } else if (event == cv::EVENT_LBUTTONUP) {
-        draggingBar_ = false;
-    }
+    if (event == cv::EVENT_LBUTTONDOWN && inside) draggingBar_ = true;
 }
 
 
 
-PlayerApp::PlayerApp(VideoSource video,
-                     std::optional<SubtitleTrack> subs,
+PlayerApp::PlayerApp(std::unique_ptr<FrameSource> video,
+                     std::shared_ptr<SubtitleStream> subs,
                      SubtitleRenderer renderer)
     : video_(std::move(video))
     , subs_(std::move(subs))
     , renderer_(std::move(renderer))
+    , scheduler_(video_->fps())
+    , hudGlyphs_(cv::FONT_HERSHEY_SIMPLEX, 0.8, 2)
 {
-    double fps = video_.fps();
-    frameDelayMs_ = static_cast<int>(1000.0 / std::max(1.0, fps));
+    activeCues_.reserve(kMaxActiveCues);
 }
 
 void PlayerApp::handleKey(int key) {
+    lastInput_ = PresentationScheduler::Clock::now();
+    dirty_ = true;
+
+    if (typingQuery_) {
+        handleSearchKey(key);
+        return;
+    }
+
+    // Esc first dismisses the results of the last search; only then quits.
+    if (key == 27 && searchPromptShown()) {
+        query_.clear();
+        hits_.clear();
+        searched_ = false;
+        return;
+    }
+
     if (key == 27 || key == 'q' || key == 'Q') {
         paused_ = true;
         subsOffsetMs_ = (std::numeric_limits<int64_t>::min)();
@@ -85,134 +142,264 @@ void PlayerApp::handleKey(int key) {
 
     if (key == ' ') paused_ = !paused_;
 
-    if (key == 'a' || key == 'A') video_.seekMs(video_.timeMs() - 5000);
-    if (key == 'd' || key == 'D') video_.seekMs(video_.timeMs() + 5000);
+    if (key == 'a' || key == 'A') seekBy(-5000);
+    if (key == 'd' || key == 'D') seekBy(5000);
+
+    if (key == ' ') scheduler_.invalidate();
+
+    if (key == 's' || key == 'S') {
+        showStats_ = !showStats_;
+        stats_.setEnabled(showStats_ || !statsPath_.empty());
+    }
 
     if (key == 'j' || key == 'J') subsOffsetMs_ -= 100;
     if (key == 'k' || key == 'K') subsOffsetMs_ += 100;
     if (key == '0') subsOffsetMs_ = 0;
-}
 
-void PlayerApp::drawHud(cv::Mat& frame, int64_t t_ms) const {
-    std::ostringstream oss;
-    oss << "t=" << t_ms << "ms"
-        << "  paused=" << (paused_ ? "yes" : "no")
-        << "  offset=" << subsOffsetMs_ << "ms";
-
-    cv::putText(frame, oss.str(), {20, 40},
-                cv::FONT_HERSHEY_SIMPLEX, 0.8,
-                cv::Scalar(255, 255, 255), 2, cv::LINE_AA);
+    if (key == '/') {
+        typingQuery_ = true;
+        query_.clear();
+        hits_.clear();
+        searched_ = false;
+        adoptSearchIndex();
+    }
+    if (key == 'n' || key == 'N') stepHit(+1);
+    if (key == 'p' || key == 'P') stepHit(-1);
 }
 
-static std::string formatTime(int64_t ms) {
-    if (ms < 0) ms = 0;
-    int64_t totalSec = ms / 1000;
-    int64_t m = totalSec / 60;
-    int64_t s = totalSec % 60;
-
-    std::ostringstream oss;
-    oss << m << ":" << std::setw(2) << std::setfill('0') << s;
-    return oss.str();
+void PlayerApp::handleSearchKey(int key) {
+    if (key == 27) {
+        typingQuery_ = false;
+        query_.clear();
+        return;
+    }
+    if (key == 13 || key == 10) {
+        typingQuery_ = false;
+        runSearch();
+        return;
+    }
+    if (key == 8 || key == 127) {
+        if (!query_.empty()) query_.pop_back();
+        return;
+    }
+    // waitKey reports printable keys as ASCII; anything else is ignored.
+    if (key >= 32 && key < 127 && query_.size() < kMaxQuery) query_ += static_cast<char>(key);
 }
 
-void PlayerApp::drawProgressBar(cv::Mat& frame, int64_t t_ms) const {
-    bar_.valid = false;
-    bar_.durMs = 0;
-    bar_.frameW = frame.cols;
-    bar_.frameH = frame.rows;
-
-    const int64_t dur = video_.durationMs();
-    if (dur <= 0) return;
+void PlayerApp::adoptSearchIndex() {
+    if (search_ || !subs_) return;
 
-    bar_.durMs = dur;
+    if (pendingSearch_) {
+        if (!pendingSearch_->ready.load(std::memory_order_acquire)) return;
+        search_ = std::move(pendingSearch_->index);
+        pendingSearch_.reset();
+        dirty_ = true;
 
-    if (t_ms < 0) t_ms = 0;
-    if (t_ms > dur) t_ms = dur;
+        std::cerr << "search index: " << search_->size() << " cues, " << search_->words() << " words, "
+                  << (search_->bytes() >> 10) << " KiB\n";
+        if (searched_) runSearch();
+        return;
+    }
 
-    const int W = frame.cols;
-    const int H = frame.rows;
+    // Indexes the whole track once it is in; the snapshot keeps the text
+    // alive for the index.
+    if (!searchPromptShown() || !subsView_ || !subsView_->complete()) return;
+
+    pendingSearch_ = std::make_shared<PendingSearch>();
+    searchIndexer_ = std::jthread([slot = pendingSearch_, snap = subsView_] {
+        std::vector<CueView> cues;
+        cues.reserve(snap->size());
+        snap->forEachCue([&](const CueView& c) { cues.push_back(c); });
+        slot->index = std::make_shared<const SubtitleSearchIndex>(std::move(cues), snap);
+        slot->ready.store(true, std::memory_order_release);
+    });
+}
 
-    bar_.frameW = W;
-    bar_.frameH = H;
+void PlayerApp::runSearch() {
+    searched_ = true;
+    hits_.clear();
+    hit_ = 0;
+    if (!search_ || query_.empty()) return;
+
+    const std::span<const uint32_t> found = search_->find(query_, hitScratch_);
+    hits_.assign(found.begin(), found.end());
+    if (hits_.empty()) return;
+
+    // Hits are in start order: take the first one after the cue time now
+    // on screen, wrapping around to the first.
+    const int64_t ts = video_->timeMs() + subsOffsetMs_;
+    const auto next = std::partition_point(hits_.begin(), hits_.end(),
+                                           [&](uint32_t id) { return search_->cue(id).start_ms <= ts; });
+    jumpToHit(next == hits_.end() ? 0 : static_cast<size_t>(next - hits_.begin()));
+}
 
+void PlayerApp::stepHit(int dir) {
+    if (hits_.empty()) return;
+    const size_t n = hits_.size();
+    jumpToHit((hit_ + (dir > 0 ? 1 : n - 1)) % n);
+}
 
-    const int padX = std::max(30, W / 20);
+void PlayerApp::jumpToHit(size_t i) {
+    hit_ = i;
+    // The cue shows when video time + offset reaches its start.
+    seeks_.post(search_->cue(hits_[i]).start_ms - subsOffsetMs_, SeekMode::Exact);
+}
 
-    const int panelH = std::max(26, H / 28); 
-    const int barH   = std::max(4,  H / 180); 
-    const int yPanelTop = H - panelH;
+// snprintf into a fixed buffer; returns the written part.
+template <class... Args>
+static std::string_view formatInto(std::span<char> buf, const char* fmt, Args... args) {
+    const int n = std::snprintf(buf.data(), buf.size(), fmt, args...);
+    if (n <= 0) return {};
+    return {buf.data(), std::min(static_cast<size_t>(n), buf.size() - 1)};
+}
 
-    {
-        cv::Rect panel(0, yPanelTop, W, panelH);
-        cv::Mat roi = frame(panel);
-        cv::Mat overlay;
-        roi.copyTo(overlay);
-        overlay.setTo(cv::Scalar(0, 0, 0));
-        cv::addWeighted(overlay, 0.35, roi, 0.65, 0, roi);
+void PlayerApp::drawHud(cv::Mat& frame, int64_t t_ms) const {
+    std::span<char> buf = scratch_.text(FrameScratch::HudText);
+
+    std::string_view text = formatInto(buf, "t=%lldms  paused=%s  offset=%lldms",
+                                       static_cast<long long>(t_ms),
+                                       paused_ ? "yes" : "no",
+                                       static_cast<long long>(subsOffsetMs_));
+
+    if (video_->isAsync()) {
+        const AsyncDecoder::Stats st = video_->asyncStats();
+        std::string_view tail = formatInto(buf.subspan(text.size()), "  queue=%zu/%zu  stalls=%llu",
+                                           st.depth, st.capacity,
+                                           static_cast<unsigned long long>(st.producerStalls));
+        text = {buf.data(), text.size() + tail.size()};
     }
 
-    const std::string left  = formatTime(t_ms);
-    const std::string right = formatTime(dur);
+    hudGlyphs_.draw(frame, text, {20, 40}, cv::Scalar(255, 255, 255));
 
-    const double textScale = std::max(0.6, H / 900.0);
-    const int textTh = 2;
+    if (subsFailed()) {
+        text = formatInto(scratch_.text(FrameScratch::ErrorLine), "subtitles stop early: %s",
+                          subsView_->error().c_str());
+        hudGlyphs_.draw(frame, text, {20, 40 + kHudLineH}, cv::Scalar(80, 80, 255));
+    }
 
-    int base = 0;
-    cv::Size szL = cv::getTextSize(left,  cv::FONT_HERSHEY_SIMPLEX, textScale, textTh, &base);
-    cv::Size szR = cv::getTextSize(right, cv::FONT_HERSHEY_SIMPLEX, textScale, textTh, &base);
+    drawSearchPrompt(frame);
+    if (showStats_) drawStatsOverlay(frame);
+}
 
-    const int textY = yPanelTop + std::max(28, panelH / 2);
+void PlayerApp::drawSearchPrompt(cv::Mat& frame) const {
+    if (!searchPromptShown()) return;
 
-    cv::putText(frame, left,  {padX, textY},
-                cv::FONT_HERSHEY_SIMPLEX, textScale,
-                cv::Scalar(255, 255, 255), textTh, cv::LINE_AA);
+    std::span<char> buf = scratch_.text(FrameScratch::SearchLine);
+    const char* q = query_.c_str();
 
-    cv::putText(frame, right, {W - padX - szR.width, textY},
-                cv::FONT_HERSHEY_SIMPLEX, textScale,
-                cv::Scalar(255, 255, 255), textTh, cv::LINE_AA);
+    std::string_view text;
+    if (typingQuery_) text = formatInto(buf, "/%s_", q);
+    else if (!subs_) text = formatInto(buf, "/%s  no subtitles", q);
+    else if (!search_) text = formatInto(buf, "/%s  indexing subtitles...", q);
+    else if (hits_.empty()) text = formatInto(buf, "/%s  no matches", q);
+    else text = formatInto(buf, "/%s  %zu/%zu  (N/P)", q, hit_ + 1, hits_.size());
+
+    const int y = 40 + kHudLineH * (subsFailed() ? 2 : 1);
+    hudGlyphs_.draw(frame, text, {20, y}, cv::Scalar(120, 255, 120));
+}
 
-    const int x0 = padX + szL.width + 20;
-    const int x1 = (W - padX - szR.width - 20);
-    if (x1 <= x0 + 10) return;
+void PlayerApp::drawStatsOverlay(cv::Mat& frame) const {
+    std::span<char> buf = scratch_.text(FrameScratch::StatsLine);
+    const cv::Scalar color(120, 255, 255);
+    constexpr double kMs = 1e6;
+
+    int y = 40 + kHudLineH * (1 + subsFailed() + searchPromptShown());
+    auto line = [&](std::string_view text) {
+        hudGlyphs_.draw(frame, text, {20, y}, color);
+        y += kHudLineH;
+    };
+
+    line(formatInto(buf, "frames=%llu  late=%llu  dropped=%llu  allocs/frame p99=%llu",
+                    static_cast<unsigned long long>(stats_.frames()),
+                    static_cast<unsigned long long>(stats_.late()),
+                    static_cast<unsigned long long>(stats_.dropped()),
+                    static_cast<unsigned long long>(stats_.allocations().quantile(0.99))));
+    line(formatInto(buf, "drift %+.2f ms  |drift| p99 %.2f ms",
+                    stats_.lastDriftNs() / kMs, stats_.drift().quantile(0.99) / kMs));
+
+    const Histogram& f = stats_.frameTime();
+    line(formatInto(buf, "%-12s p50 %6.2f  p99 %6.2f  max %6.2f ms", "frame",
+                    f.quantile(0.5) / kMs, f.quantile(0.99) / kMs, f.max() / kMs));
+
+    for (size_t s = 0; s < FrameStats::StageCount; ++s) {
+        const auto stage = static_cast<FrameStats::Stage>(s);
+        const Histogram& h = stats_.stage(stage);
+        line(formatInto(buf, "%-12s p50 %6.2f  p99 %6.2f  max %6.2f ms", FrameStats::stageName(stage),
+                        h.quantile(0.5) / kMs, h.quantile(0.99) / kMs, h.max() / kMs));
+    }
+}
 
-    const int yBarCenter = yPanelTop + panelH / 2;
-    const int yBarTop = yBarCenter - barH / 2;
+void PlayerApp::drawProgressBar(cv::Mat& frame, int64_t t_ms) const {
+    progressBar_.draw(frame, t_ms, video_->durationMs());
+}
 
-    bar_.valid = true;
-    bar_.x0 = x0;
-    bar_.x1 = x1;
+void PlayerApp::drawThumbnail(cv::Mat& frame) const {
+    const ProgressBarLayer::Geometry& bar = progressBar_.geometry();
+    if (!thumbs_ || hoverX_ < 0 || !bar.valid || bar.durMs <= 0) return;
 
-    bar_.y0 = std::max(0, yBarTop - 8);
-    bar_.y1 = std::min(H - 1, yBarTop + barH + 8);
+    const cv::Mat thumb = thumbs_->nearest(timeAtX(hoverX_));
+    if (thumb.empty()) return;
 
+    const int w = thumb.cols + 2 * kThumbBorder;
+    const int h = thumb.rows + 2 * kThumbBorder;
+    const int y = bar.y0 - kThumbGap - h;
+    if (w > frame.cols || y < 0) return;
 
+    const int x = std::clamp(hoverX_ - w / 2, 0, frame.cols - w);
+    frame(cv::Rect(x, y, w, h)).setTo(cv::Scalar(230, 230, 230));
+    thumb.copyTo(frame(cv::Rect(x + kThumbBorder, y + kThumbBorder, thumb.cols, thumb.rows)));
+}
 
-    double ratio = static_cast<double>(t_ms) / static_cast<double>(dur);
-    ratio = std::clamp(ratio, 0.0, 1.0);
 
-    const int filled = x0 + static_cast<int>((x1 - x0) * ratio);
+cv::Mat& PlayerApp::fitToWindow(const cv::Mat& frame) {
+    const cv::Rect win = cv::getWindowImageRect("player");
+    shownWindow_ = win.size();
+    if (win.width <= 0 || win.height <= 0 || (win.width >= frame.cols && win.height >= frame.rows)) {
+        renderer_.setScale(1.0);
+        frame.copyTo(display_);
+        return display_;
+    }
 
-    cv::rectangle(frame,
-                  cv::Rect(x0, yBarTop, x1 - x0, barH),
-                  cv::Scalar(90, 90, 90),
-                  cv::FILLED);
+    // One factor for both axes keeps the aspect ratio, and the cues are
+    // scaled by the same factor as the picture under them.
+    const double k = std::min({static_cast<double>(win.width) / frame.cols,
+                               static_cast<double>(win.height) / frame.rows, 1.0});
+    const cv::Size size(std::max(1, static_cast<int>(frame.cols * k)),
+                        std::max(1, static_cast<int>(frame.rows * k)));
+    cv::resize(frame, display_, size, 0, 0, cv::INTER_AREA);
+
+    // Quantized, so resizing the window does not rasterize every cue again
+    // at each intermediate size.
+    const double steps = std::round(kScaleSteps * k);
+    renderer_.setScale(std::max(1.0, steps) / kScaleSteps);
+    return display_;
+}
 
-    cv::rectangle(frame,
-                  cv::Rect(x0, yBarTop, std::max(0, filled - x0), barH),
-                  cv::Scalar(230, 230, 230),
-                  cv::FILLED);
+bool PlayerApp::upToDate() const {
+    if (dirty_) return false;
+    if (cv::getWindowImageRect("player").size() != shownWindow_) return false;
+    if (subs_ && (!subsView_ || !subsView_->complete())) return false;
+    if (hoverX_ >= 0 && thumbs_ && thumbs_->ready() != thumbsShown_) return false;
+    return true;
+}
 
-    const int knobR = std::max(4, barH + 2);
+void PlayerApp::enableStats(std::filesystem::path jsonOut) {
+    statsPath_ = std::move(jsonOut);
+    stats_.setEnabled(true);
+}
 
+void PlayerApp::enableThumbnails(const std::filesystem::path& videoPath) {
+    thumbs_ = ThumbnailIndex::load(videoPath);
+    if (thumbs_) return;
 
-    const int kx = std::clamp(filled, x0, x1);
-    const int ky = yBarCenter;
+    thumbs_ = ThumbnailIndex::plan(video_->durationMs(), video_->frameSize());
+    if (!thumbs_) return;
 
-    cv::circle(frame, {kx, ky}, knobR, cv::Scalar(255, 255, 255), cv::FILLED, cv::LINE_AA);
-    cv::circle(frame, {kx, ky}, knobR, cv::Scalar(0, 0, 0), 1, cv::LINE_AA);
+    thumbnailer_ = std::jthread([idx = thumbs_, videoPath](std::stop_token stop) {
+        if (idx->build(videoPath, stop)) idx->save(videoPath);
+    });
 }
 
-
 int PlayerApp::run() {
     cv::namedWindow("player", cv::WINDOW_NORMAL);
 
@@ -220,40 +407,124 @@ int PlayerApp::run() {
 
 
     cv::Mat frame;
+    int frameNo = 0;
+
+    using Clock = PresentationScheduler::Clock;
+    int64_t lastPts = 0;
 
     while (true) {
+        StageClock clock(stats_);
+        const uint64_t frameAllocsBefore = AllocCounter::thisThread();
+
+        applyPendingSeek();
+        adoptSearchIndex();
 
+        bool fresh = false;
         if (paused_ && needRefreshFrame_) {
-        video_.read(frame);
-        needRefreshFrame_ = false;
-    }
+            fresh = video_->read(frame);
+            needRefreshFrame_ = false;
+        }
         if (!paused_) {
-            if (!video_.read(frame)) break; 
+            // Behind schedule: step over frames without retrieving them.
+            const int64_t behind = scheduler_.framesToSkip(lastPts, Clock::now());
+            if (behind > 0) stats_.addDropped(video_->skipFrames(static_cast<size_t>(behind)));
+
+            if (!video_->read(frame)) break; 
+            fresh = true;
         }
 
         if (frame.empty()) continue;
 
-        int64_t t = video_.timeMs();
+        // Paused and nothing changed: what is on screen is still right, so
+        // just wait for input.
+        if (!fresh && upToDate()) {
+            const bool active = Clock::now() - lastInput_ < kInputActivity;
+            const int key = cv::waitKey(active ? kActiveWaitMs : kIdleWaitMs);
+            if (key != -1) handleKey(key);
+            continue;
+        }
+        dirty_ = false;
+        thumbsShown_ = thumbs_ ? thumbs_->ready() : 0;
+
+        cv::Mat& canvas = fitToWindow(frame);
+        clock.mark(FrameStats::Read);
+
+        int64_t t = video_->timeMs();
+        lastPts = t;
+        if (!paused_ && !scheduler_.anchored()) scheduler_.anchor(t, Clock::now());
 
         if (subsOffsetMs_ == (std::numeric_limits<int64_t>::min)()) break;
 
+        const uint64_t allocsBefore = AllocCounter::thisThread();
+
         if (subs_) {
             int64_t ts = t + subsOffsetMs_;
             if (ts < 0) ts = 0;
 
-            if (const SubtitleCue* cue = subs_->activeAt(ts)) {
-                renderer_.draw(frame, *cue);
-            }
+            // Keep the last snapshot once parsing is done; until then pick
+            // up new chunks and steer the parser towards the playhead.
+            if (!subsView_ || !subsView_->complete()) subsView_ = subs_->snapshot();
+            if (!subsView_->covers(ts)) subs_->prioritize(ts);
+
+            auto active = subsView_->activeRange(ts, activeCues_);
+            if (!active.empty()) renderer_.draw(canvas, active);
+
+            renderer_.prefetch(subsView_->startingAfter(ts, kPrefetchCues), canvas.cols);
+        }
+        clock.mark(FrameStats::Subtitles);
+
+        drawHud(canvas, t);
+        clock.mark(FrameStats::Hud);
+        drawProgressBar(canvas, t);
+        drawThumbnail(canvas);
+        clock.mark(FrameStats::ProgressBar);
+
+        const uint64_t allocs = AllocCounter::thisThread() - allocsBefore;
+        if (++frameNo > kAllocWarmupFrames && allocs != 0) {
+            std::cerr << "compositing allocated " << allocs
+                      << " times on frame " << frameNo << "\n";
+        }
+
+        // Sleep out whatever is left of the budget; waitKey keeps the
+        // window responsive meanwhile. Sub-millisecond remainders are
+        // shown early rather than late.
+        int waitedKey = -1;
+        if (!paused_) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                scheduler_.dueTime(t) - Clock::now());
+            if (left.count() >= 1) waitedKey = cv::waitKey(static_cast<int>(left.count()));
         }
+        clock.mark(FrameStats::WaitKey);
 
-        drawHud(frame, t);
-        drawProgressBar(frame, t);
+        cv::imshow("player", canvas);
+        const int key = cv::waitKey(paused_ ? kActiveWaitMs : 1);
+        clock.mark(FrameStats::Show);
 
+        if (!paused_ && clock.on()) {
+            const double driftMs = static_cast<double>(t) - scheduler_.mediaNowMs(Clock::now());
+            stats_.recordDrift(static_cast<int64_t>(driftMs * 1e6));
+            if (-driftMs > scheduler_.framePeriodMs() / 2) stats_.addLate();
+        }
+        if (clock.on()) stats_.recordFrame(clock.elapsedNs(), AllocCounter::thisThread() - frameAllocsBefore);
 
-        cv::imshow("player", frame);
-        int key = cv::waitKey(paused_ ? 30 : frameDelayMs_);
+        if (waitedKey != -1) handleKey(waitedKey);
         if (key != -1) handleKey(key);
     }
 
+    if (video_->isAsync()) {
+        const AsyncDecoder::Stats st = video_->asyncStats();
+        std::cerr << "decode-ahead: capacity=" << st.capacity
+                  << " producer_stalls=" << st.producerStalls
+                  << " underruns=" << st.underruns << "\n";
+    }
+    if (seeks_.coalesced() != 0) std::cerr << "seeks coalesced: " << seeks_.coalesced() << "\n";
+
+    if (!statsPath_.empty()) {
+        std::ofstream out(statsPath_);
+        stats_.writeJson(out);
+        if (out) std::cerr << "stats written to " << statsPath_.string() << "\n";
+        else std::cerr << "cannot write stats to " << statsPath_.string() << "\n";
+    }
+
     return 0;
 }
@@ -0,0 +1,41 @@
+#include "app/PresentationScheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using MsF = std::chrono::duration<double, std::milli>;
+
+PresentationScheduler::PresentationScheduler(double fps)
+    : periodMs_(1000.0 / std::max(1.0, fps))
+{
+}
+
+void PresentationScheduler::anchor(int64_t mediaMs, Clock::time_point now) noexcept {
+    anchored_ = true;
+    anchorMediaMs_ = mediaMs;
+    anchorWall_ = now;
+}
+
+PresentationScheduler::Clock::time_point
+PresentationScheduler::dueTime(int64_t ptsMs) const noexcept {
+    return anchorWall_ + std::chrono::duration_cast<Clock::duration>(
+                             MsF(static_cast<double>(ptsMs - anchorMediaMs_)));
+}
+
+double PresentationScheduler::mediaNowMs(Clock::time_point now) const noexcept {
+    return static_cast<double>(anchorMediaMs_) + MsF(now - anchorWall_).count();
+}
+
+int64_t PresentationScheduler::framesToSkip(int64_t lastPtsMs, Clock::time_point now) noexcept {
+    if (!anchored_) return 0;
+
+    const double nextPts = static_cast<double>(lastPtsMs) + periodMs_;
+    const double lateMs = mediaNowMs(now) - nextPts;
+    if (lateMs <= periodMs_) return 0;
+
+    if (lateMs > MsF(kMaxCatchUp).count()) {
+        anchor(static_cast<int64_t>(nextPts), now);
+        return 0;
+    }
+    return static_cast<int64_t>(std::floor(lateMs / periodMs_));
+}
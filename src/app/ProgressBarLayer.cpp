@@ -0,0 +1,197 @@
+#include "app/ProgressBarLayer.hpp"
+
+#include "render/BlendKernels.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+
+namespace {
+
+// Dims the video under the panel to 65%, as addWeighted did.
+constexpr double kPanelKeep = 0.65;
+constexpr int kLabelGap = 20;
+constexpr int kTextThickness = 2;
+
+const cv::Scalar kTrackColor(90, 90, 90);
+const cv::Scalar kFillColor(230, 230, 230);
+const cv::Scalar kTextColor(255, 255, 255);
+
+std::string_view formatTime(std::span<char> buf, int64_t ms) {
+    if (ms < 0) ms = 0;
+    const int64_t totalSec = ms / 1000;
+    const int n = std::snprintf(buf.data(), buf.size(), "%lld:%02lld",
+                                static_cast<long long>(totalSec / 60), static_cast<long long>(totalSec % 60));
+    if (n <= 0) return {};
+    return {buf.data(), std::min(static_cast<size_t>(n), buf.size() - 1)};
+}
+
+}  // namespace
+
+cv::Rect ProgressBarLayer::knobRect(int x) const {
+    const int half = knobR_ + 2;
+    return {x - half, barCenter_ - half, 2 * half + 1, 2 * half + 1};
+}
+
+void ProgressBarLayer::renderKnob() {
+    const int half = knobR_ + 2;
+    if (knobAlpha_.rows == 2 * half + 1) return;
+
+    cv::Mat onBlack(2 * half + 1, 2 * half + 1, CV_8UC1, cv::Scalar(0));
+    cv::Mat onWhite(2 * half + 1, 2 * half + 1, CV_8UC1, cv::Scalar(255));
+    for (cv::Mat* canvas : {&onBlack, &onWhite}) {
+        cv::circle(*canvas, {half, half}, knobR_, cv::Scalar(255), cv::FILLED, cv::LINE_AA);
+        cv::circle(*canvas, {half, half}, knobR_, cv::Scalar(0), 1, cv::LINE_AA);
+    }
+    matteToPremultiplied(onBlack, onWhite, knobColor_, knobAlpha_);
+}
+
+void ProgressBarLayer::drawLabel(std::string_view text, int x) {
+    labelGlyphs_->draw(baseColor_, text, {x, textY_}, kTextColor);
+    labelGlyphs_->draw(baseKeep_, text, {x, textY_}, cv::Scalar(0, 0, 0));
+}
+
+void ProgressBarLayer::layout(cv::Size frameSize, int64_t durMs) {
+    const int W = frameSize.width;
+    const int H = frameSize.height;
+
+    geom_ = {};
+    geom_.frameW = W;
+    geom_.frameH = H;
+    geom_.durMs = durMs;
+
+    const int panelH = std::min(H, std::max(26, H / 28));
+    panelTop_ = H - panelH;
+    padX_ = std::max(30, W / 20);
+    barH_ = std::max(4, H / 180);
+    barCenter_ = panelH / 2;
+    barTop_ = barCenter_ - barH_ / 2;
+    textY_ = std::max(28, panelH / 2);
+    knobR_ = std::max(4, barH_ + 2);
+
+    const double textScale = std::max(0.6, H / 900.0);
+    if (!labelGlyphs_ || labelGlyphs_->fontScale() != textScale) {
+        labelGlyphs_ = std::make_unique<GlyphStamps>(cv::FONT_HERSHEY_SIMPLEX, textScale, kTextThickness);
+    }
+
+    // Both labels get a slot as wide as the duration with every digit at its
+    // widest, so the clock never pushes the bar around as it ticks.
+    std::array<char, 32> buf{};
+    const std::string_view duration = formatTime(buf, durMs);
+    std::array<char, 32> widest{};
+    char wideDigit = '0';
+    for (char d = '1'; d <= '9'; ++d) {
+        if (labelGlyphs_->textWidth({&d, 1}) > labelGlyphs_->textWidth({&wideDigit, 1})) wideDigit = d;
+    }
+    std::transform(duration.begin(), duration.end(), widest.begin(),
+                   [&](char c) { return c >= '0' && c <= '9' ? wideDigit : c; });
+    labelW_ = labelGlyphs_->textWidth({widest.data(), duration.size()});
+
+    baseColor_.create(panelH, W, CV_8UC3);
+    baseKeep_.create(panelH, W, CV_8UC3);
+    baseColor_.setTo(cv::Scalar::all(0));
+    baseKeep_.setTo(cv::Scalar::all(255));
+
+    drawLabel(duration, W - padX_ - labelGlyphs_->textWidth(duration));
+
+    const int x0 = padX_ + labelW_ + kLabelGap;
+    const int x1 = W - padX_ - labelW_ - kLabelGap;
+    if (x1 > x0 + 10) {
+        geom_.valid = true;
+        geom_.x0 = x0;
+        geom_.x1 = x1;
+        geom_.y0 = std::max(0, panelTop_ + barTop_ - 8);
+        geom_.y1 = std::min(H - 1, panelTop_ + barTop_ + barH_ + 8);
+
+        const cv::Rect track = cv::Rect(x0, barTop_, x1 - x0, barH_) & cv::Rect(0, 0, W, panelH);
+        baseColor_(track).setTo(kTrackColor);
+        baseKeep_(track).setTo(cv::Scalar::all(0));
+    }
+
+    baseColor_.copyTo(liveColor_);
+    baseKeep_.copyTo(liveKeep_);
+    renderKnob();
+    clockLen_ = 0;
+    fillX_ = -1;
+}
+
+void ProgressBarLayer::repaint(cv::Rect dirty) {
+    const cv::Rect layer(0, 0, liveColor_.cols, liveColor_.rows);
+
+    // The knob is blended, so it is either redrawn whole or not at all.
+    const bool knobDirty = fillX_ >= 0 && (knobRect(fillX_) & dirty).area() > 0;
+    if (knobDirty) dirty |= knobRect(fillX_);
+    dirty &= layer;
+    if (dirty.area() == 0) return;
+
+    baseColor_(dirty).copyTo(liveColor_(dirty));
+    baseKeep_(dirty).copyTo(liveKeep_(dirty));
+    if (fillX_ < 0) return;
+
+    const cv::Rect fill = cv::Rect(geom_.x0, barTop_, fillX_ - geom_.x0, barH_) & dirty;
+    liveColor_(fill).setTo(kFillColor);
+    liveKeep_(fill).setTo(cv::Scalar::all(0));
+    if (!knobDirty) return;
+
+    const cv::Point at = knobRect(fillX_).tl();
+    blitPremultiplied(liveColor_, knobColor_, knobAlpha_, at);
+    blendSolid(liveKeep_, knobAlpha_, at, cv::Scalar(0, 0, 0));
+}
+
+void ProgressBarLayer::setClock(std::string_view text) {
+    if (text.size() == clockLen_ && std::equal(text.begin(), text.end(), clock_.begin())) return;
+    clockLen_ = std::min(text.size(), clock_.size());
+    std::copy_n(text.begin(), clockLen_, clock_.begin());
+
+    // Reset the slot up to the middle of the gap before the track.
+    const cv::Rect slot = cv::Rect(0, 0, padX_ + labelW_ + kLabelGap / 2, baseColor_.rows) &
+                          cv::Rect(0, 0, baseColor_.cols, baseColor_.rows);
+    baseColor_(slot).setTo(cv::Scalar::all(0));
+    baseKeep_(slot).setTo(cv::Scalar::all(255));
+    drawLabel({clock_.data(), clockLen_}, padX_);
+    repaint(slot);
+}
+
+void ProgressBarLayer::moveFill(int fillX) {
+    if (fillX == fillX_) return;
+
+    cv::Rect dirty = knobRect(fillX);
+    if (fillX_ >= 0) {
+        dirty |= knobRect(fillX_);
+        dirty |= cv::Rect(std::min(fillX, fillX_), barTop_, std::abs(fillX - fillX_), barH_);
+    } else {
+        dirty |= cv::Rect(geom_.x0, barTop_, fillX - geom_.x0, barH_);
+    }
+    fillX_ = fillX;
+    repaint(dirty);
+}
+
+void ProgressBarLayer::draw(cv::Mat& frame, int64_t t_ms, int64_t durMs) {
+    if (durMs <= 0) {
+        geom_ = {};
+        geom_.frameW = frame.cols;
+        geom_.frameH = frame.rows;
+        return;
+    }
+
+    if (frame.cols != geom_.frameW || frame.rows != geom_.frameH || durMs != geom_.durMs) {
+        layout(frame.size(), durMs);
+    }
+
+    t_ms = std::clamp<int64_t>(t_ms, 0, durMs);
+
+    std::array<char, 32> buf{};
+    setClock(formatTime(buf, t_ms));
+
+    if (geom_.valid) {
+        const double ratio = static_cast<double>(t_ms) / static_cast<double>(durMs);
+        moveFill(geom_.x0 + static_cast<int>((geom_.x1 - geom_.x0) * ratio));
+    }
+
+    // The tint goes through darkenInPlace so it stays byte-exact with
+    // addWeighted; the layer is then laid over the dimmed panel.
+    cv::Mat panel = frame(cv::Rect(0, panelTop_, frame.cols, frame.rows - panelTop_));
+    darkenInPlace(panel, kPanelKeep);
+    compositeLayer(frame, liveColor_, liveKeep_, {0, panelTop_});
+}
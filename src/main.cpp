@@ -1,63 +1,240 @@
+#include "app/BatchRunner.hpp"
+#include "app/BurnInExporter.hpp"
 #include "app/PlayerApp.hpp"
 #include "render/SubtitleRenderer.hpp"
 #include "subs/SrtParser.hpp"
+#include "subs/SubtitleLocator.hpp"
+#include "subs/SubtitleStream.hpp"
+#include "video/RawVideoSource.hpp"
+#include "video/SyntheticSource.hpp"
 #include "video/VideoSource.hpp"
 
 #include <iostream>
 #include <optional>
 
 #include <filesystem>
+#include <memory>
 #include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
-static std::optional<std::filesystem::path>
-autoFindSubtitles(const std::filesystem::path& videoPath) {
-    using namespace std::filesystem;
+namespace {
 
-    path dir  = videoPath.parent_path();
-    path base = videoPath.stem();
+// "WxH[@fps][:seconds]", e.g. 3840x2160@60:30; fps and seconds keep their
+// defaults when omitted.
+struct FrameSpec {
+    cv::Size size;
+    double fps = 30.0;
+    int64_t durationMs = 60000;
+};
 
-    std::vector<path> candidates = {
-        dir / (base.string() + ".srt"),
-        dir / (base.string() + ".en.srt"),
-        dir / (base.string() + ".ru.srt"),
-    };
+FrameSpec parseFrameSpec(const std::string& spec) {
+    FrameSpec f;
+    size_t pos = 0;
+    f.size.width = std::stoi(spec, &pos);
+    if (pos >= spec.size() || spec[pos] != 'x') throw std::runtime_error("Bad frame spec: " + spec);
 
-    for (const auto& p : candidates) {
-        if (exists(p) && is_regular_file(p)) {
-            return p;
-        }
+    size_t used = 0;
+    f.size.height = std::stoi(spec.substr(pos + 1), &used);
+    pos += 1 + used;
+
+    if (pos < spec.size() && spec[pos] == '@') {
+        f.fps = std::stod(spec.substr(pos + 1), &used);
+        pos += 1 + used;
+    }
+    if (pos < spec.size() && spec[pos] == ':') {
+        f.durationMs = static_cast<int64_t>(std::stod(spec.substr(pos + 1), &used) * 1000.0);
+        pos += 1 + used;
+    }
+    if (pos != spec.size() || f.size.width <= 0 || f.size.height <= 0 || f.fps <= 0.0) {
+        throw std::runtime_error("Bad frame spec: " + spec);
     }
-    return std::nullopt;
+    return f;
 }
 
+}  // namespace
 
 int main(int argc, char** argv) {
     try {
-        if (argc < 2) {
-            std::cerr << "Usage: " << argv[0] << " <video.mp4> [subs.srt]\n";
+        std::vector<std::string> args;
+        size_t decodeAhead = 8;
+        std::optional<std::filesystem::path> exportPath;
+        unsigned jobs = 0;
+        std::string fourcc = "mp4v";
+        std::optional<std::filesystem::path> batchInput;
+        std::filesystem::path outDir = "out";
+        unsigned concurrency = 0;
+        size_t memCapMb = 0;
+        bool analyze = false;
+        std::optional<std::filesystem::path> statsPath;
+        std::optional<FrameSpec> synthetic;
+        std::optional<FrameSpec> rawBgr;
+
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (arg == "--decode-ahead" && i + 1 < argc) {
+                decodeAhead = std::stoul(argv[++i]);
+                continue;
+            }
+            if (arg == "--export" && i + 1 < argc) {
+                exportPath = argv[++i];
+                continue;
+            }
+            if (arg == "--jobs" && i + 1 < argc) {
+                jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+                continue;
+            }
+            if (arg == "--fourcc" && i + 1 < argc) {
+                fourcc = argv[++i];
+                continue;
+            }
+            if (arg == "--batch" && i + 1 < argc) {
+                batchInput = argv[++i];
+                continue;
+            }
+            if (arg == "--out-dir" && i + 1 < argc) {
+                outDir = argv[++i];
+                continue;
+            }
+            if (arg == "--concurrency" && i + 1 < argc) {
+                concurrency = static_cast<unsigned>(std::stoul(argv[++i]));
+                continue;
+            }
+            if (arg == "--mem-cap-mb" && i + 1 < argc) {
+                memCapMb = std::stoul(argv[++i]);
+                continue;
+            }
+            if (arg == "--stats" && i + 1 < argc) {
+                statsPath = argv[++i];
+                continue;
+            }
+            if (arg == "--synthetic" && i + 1 < argc) {
+                synthetic = parseFrameSpec(argv[++i]);
+                continue;
+            }
+            if (arg == "--raw-bgr" && i + 1 < argc) {
+                rawBgr = parseFrameSpec(argv[++i]);
+                continue;
+            }
+            if (arg == "--analyze") {
+                analyze = true;
+                continue;
+            }
+            args.emplace_back(arg);
+        }
+
+        if (batchInput) {
+            BatchOptions opt;
+            opt.input = *batchInput;
+            opt.outDir = outDir;
+            opt.mode = analyze ? BatchMode::Analyze : BatchMode::BurnIn;
+            opt.concurrency = concurrency;
+            opt.memoryCapBytes = memCapMb << 20;
+            opt.jobsPerFile = jobs;
+            opt.fourcc = fourcc;
+
+            BatchRunner runner(opt);
+            const BatchSummary r = runner.run();
+
+            std::cout << "Batch: " << r.done << " done, " << r.failed << " failed, "
+                      << r.skipped << " skipped; " << r.frames << " frames in "
+                      << r.seconds << " s (" << r.fps() << " fps)\n";
+            return r.failed == 0 ? 0 : 3;
+        }
+
+        // Generated frames stand in for the video, so the only positional
+        // argument is the subtitle file.
+        if (synthetic) {
+            auto video = std::make_unique<SyntheticSource>(synthetic->size, synthetic->fps, synthetic->durationMs);
+
+            std::shared_ptr<SubtitleStream> subs;
+            if (!args.empty()) subs = std::make_shared<SubtitleStream>(std::filesystem::path(args[0]));
+
+            RenderStyle st;
+            st.reservedBottomPx = 40;
+            PlayerApp app(std::move(video), std::move(subs), SubtitleRenderer(st));
+            if (statsPath) app.enableStats(*statsPath);
+            return app.run();
+        }
+
+        if (args.empty()) {
+            std::cerr << "Usage: " << argv[0] << " [--decode-ahead N] [--stats out.json] [--raw-bgr WxH@fps] <video.mp4|.y4m|.bgr> [subs.srt]\n"
+                      << "       " << argv[0] << " --synthetic WxH[@fps][:seconds] [--stats out.json] [subs.srt]\n"
+                      << "       " << argv[0] << " --export out.mp4 [--jobs N] [--fourcc XXXX] <video.mp4> [subs.srt]\n"
+                      << "       " << argv[0] << " --batch <dir|list.txt> [--out-dir D] [--analyze] [--concurrency N]\n"
+                      << "                [--mem-cap-mb M] [--jobs N] [--fourcc XXXX]\n";
             return 1;
         }
 
-        const std::filesystem::path videoPath = argv[1];
+        const std::filesystem::path videoPath = args[0];
+
+        std::optional<std::filesystem::path> srtPath;
+        if (args.size() >= 2) srtPath = args[1];
+        else srtPath = autoFindSubtitles(videoPath);
+
+        if (!srtPath) std::cout << "No subtitles provided\n";
+
+        RenderStyle st;
+
+        if (exportPath) {
+            std::optional<SubtitleTrack> subs;
+            if (srtPath) {
+                SrtParser parser;
+                subs = parser.parseFileCached(*srtPath);
+                std::cout << "Loaded subtitles: " << srtPath->string() << "\n";
+            }
+
+            ExportOptions opt;
+            opt.input = videoPath;
+            opt.output = *exportPath;
+            opt.jobs = jobs;
+            opt.fourcc = fourcc;
+            opt.style = st;
 
-        std::optional<SubtitleTrack> subs;
-        if (argc >= 3) {
-            const std::filesystem::path srtPath = argv[2];
-            SrtParser parser;
-            subs = parser.parseFile(srtPath);
-            std::cout << "Loaded subtitles: " << srtPath.string() << "\n";
+            BurnInExporter exporter(opt);
+            const ExportReport r = exporter.run(subs ? &*subs : nullptr);
+
+            std::cout << "Exported " << r.frames << " frames in " << r.seconds << " s ("
+                      << r.fps() << " fps, " << r.segments << " segments) to "
+                      << exportPath->string() << "\n";
+            return 0;
+        }
+
+        // Uncompressed inputs are read straight from a mapping; everything
+        // else goes through cv::VideoCapture with decode-ahead.
+        const bool raw = rawBgr || videoPath.extension() == ".y4m";
+        std::unique_ptr<FrameSource> video;
+        if (rawBgr) {
+            video = RawVideoSource::openBgr(videoPath, rawBgr->size, rawBgr->fps);
+        } else if (raw) {
+            video = RawVideoSource::openY4m(videoPath);
         } else {
-            std::cout << "No subtitles provided\n";
+            auto decoded = std::make_unique<VideoSource>(videoPath);
+            decoded->startAsync(decodeAhead);
+            video = std::move(decoded);
         }
 
-        VideoSource video(videoPath);
+        // Interactive playback doesn't wait for the parse; cues are published
+        // as they're read. A current compiled cache needs no parse at all.
+        std::shared_ptr<SubtitleStream> subs;
+        if (srtPath) {
+            if (auto cached = SubtitleTrack::loadCache(*srtPath)) {
+                subs = std::make_shared<SubtitleStream>(std::move(*cached));
+                std::cout << "Loaded subtitles: " << srtPath->string() << " (cached)\n";
+            } else {
+                subs = std::make_shared<SubtitleStream>(*srtPath);
+                std::cout << "Streaming subtitles: " << srtPath->string() << "\n";
+            }
+        }
         
-        RenderStyle st;
         st.reservedBottomPx = 40;
         SubtitleRenderer renderer(st);
 
         PlayerApp app(std::move(video), std::move(subs), std::move(renderer));
+        if (statsPath) app.enableStats(*statsPath);
+        if (!raw) app.enableThumbnails(videoPath);
 
         std::cerr << "MAIN: before run\n";
         int rc = app.run();
@@ -69,4 +246,3 @@ int main(int argc, char** argv) {
         return 2;
     }
 }
-
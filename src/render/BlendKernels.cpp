@@ -0,0 +1,347 @@
+#include "render/BlendKernels.hpp"
+
+#include "util/ParallelRows.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Exact x / 255 rounded to nearest for x in [0, 255 * 255].
+static inline int div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// Clips the rectangle of a size-sized overlay at `at` against the frame and
+// returns it in overlay coordinates.
+static cv::Rect clipToFrame(const cv::Mat& frame, cv::Size size, cv::Point at) {
+    const int c0 = std::max(0, -at.x);
+    const int r0 = std::max(0, -at.y);
+    const int c1 = std::min(size.width, frame.cols - at.x);
+    const int r1 = std::min(size.height, frame.rows - at.y);
+    return {c0, r0, std::max(0, c1 - c0), std::max(0, r1 - r0)};
+}
+
+// addWeighted evaluates 0 * alpha + src * beta + gamma in float and rounds
+// half to even; with a black overlay that is lrintf(src * beta). The SIMD
+// paths do the same multiply in float and convert with the default MXCSR
+// rounding, which is also half to even.
+namespace {
+
+using DarkenRowFn = void (*)(uchar* p, int n, float beta, const uchar* lut);
+
+void darkenRowScalar(uchar* p, int n, float, const uchar* lut) {
+    for (int x = 0; x < n; ++x) p[x] = lut[p[x]];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse2")))
+void darkenRowSse2(uchar* p, int n, float beta, const uchar* lut) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 b = _mm_set1_ps(beta);
+
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+        const __m128i r0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), b));
+        const __m128i r1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), b));
+        const __m128i r2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), b));
+        const __m128i r3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), b));
+
+        const __m128i out = _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + x), out);
+    }
+    darkenRowScalar(p + x, n - x, beta, lut);
+}
+
+__attribute__((target("avx2")))
+inline __m256i scale8Avx2(const uchar* src, __m256 b) {
+    const __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+    return _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(v), b));
+}
+
+__attribute__((target("avx2")))
+void darkenRowAvx2(uchar* p, int n, float beta, const uchar* lut) {
+    const __m256 b = _mm256_set1_ps(beta);
+    // packs/packus work per 128-bit lane; this puts the dwords back in order.
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    int x = 0;
+    for (; x + 32 <= n; x += 32) {
+        const __m256i r0 = scale8Avx2(p + x, b);
+        const __m256i r1 = scale8Avx2(p + x + 8, b);
+        const __m256i r2 = scale8Avx2(p + x + 16, b);
+        const __m256i r3 = scale8Avx2(p + x + 24, b);
+
+        const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(r0, r1), _mm256_packs_epi32(r2, r3));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + x), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    darkenRowSse2(p + x, n - x, beta, lut);
+}
+
+#endif
+
+using LayerRowFn = void (*)(uchar* d, const uchar* color, const uchar* keep, int n);
+
+void layerRowScalar(uchar* d, const uchar* color, const uchar* keep, int n) {
+    for (int x = 0; x < n; ++x) d[x] = static_cast<uchar>(std::min(div255(d[x] * keep[x]) + color[x], 255));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// div255 on 16-bit lanes: d * keep + 128 stays below 65536.
+__attribute__((target("sse2")))
+inline __m128i layerLanesSse2(__m128i d, __m128i keep) {
+    const __m128i x = _mm_add_epi16(_mm_mullo_epi16(d, keep), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("sse2")))
+void layerRowSse2(uchar* d, const uchar* color, const uchar* keep, int n) {
+    const __m128i zero = _mm_setzero_si128();
+
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + x));
+        const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keep + x));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(color + x));
+
+        const __m128i lo = layerLanesSse2(_mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(k, zero));
+        const __m128i hi = layerLanesSse2(_mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(k, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x), _mm_adds_epu8(_mm_packus_epi16(lo, hi), c));
+    }
+    layerRowScalar(d + x, color + x, keep + x, n - x);
+}
+
+__attribute__((target("avx2")))
+inline __m256i layerLanesAvx2(__m256i d, __m256i keep) {
+    const __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(d, keep), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+// Unpack and pack both work per 128-bit lane, so bytes come back in order.
+__attribute__((target("avx2")))
+void layerRowAvx2(uchar* d, const uchar* color, const uchar* keep, int n) {
+    const __m256i zero = _mm256_setzero_si256();
+
+    int x = 0;
+    for (; x + 32 <= n; x += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + x));
+        const __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keep + x));
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(color + x));
+
+        const __m256i lo = layerLanesAvx2(_mm256_unpacklo_epi8(v, zero), _mm256_unpacklo_epi8(k, zero));
+        const __m256i hi = layerLanesAvx2(_mm256_unpackhi_epi8(v, zero), _mm256_unpackhi_epi8(k, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x), _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), c));
+    }
+    layerRowSse2(d + x, color + x, keep + x, n - x);
+}
+
+#endif
+
+LayerRowFn layerRowFnFor(KernelIsa isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (isa == KernelIsa::Avx2 && __builtin_cpu_supports("avx2")) return layerRowAvx2;
+    if (isa != KernelIsa::Scalar && __builtin_cpu_supports("sse2")) return layerRowSse2;
+#else
+    (void)isa;
+#endif
+    return layerRowScalar;
+}
+
+DarkenRowFn rowFnFor(KernelIsa isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (isa == KernelIsa::Avx2 && __builtin_cpu_supports("avx2")) return darkenRowAvx2;
+    if (isa != KernelIsa::Scalar && __builtin_cpu_supports("sse2")) return darkenRowSse2;
+#else
+    (void)isa;
+#endif
+    return darkenRowScalar;
+}
+
+struct DarkenJob {
+    cv::Mat* roi;
+    int rowBytes;
+    float beta;
+    std::array<uchar, 256> lut;
+    DarkenRowFn row;
+
+    void operator()(int r0, int r1) const {
+        for (int r = r0; r < r1; ++r) row(roi->ptr<uchar>(r), rowBytes, beta, lut.data());
+    }
+};
+
+void prepare(DarkenJob& job, cv::Mat& roi, double keep, KernelIsa isa) {
+    CV_Assert(roi.depth() == CV_8U);
+
+    job.roi = &roi;
+    job.rowBytes = roi.cols * roi.channels();
+    job.beta = static_cast<float>(keep);
+    for (int v = 0; v < 256; ++v) {
+        const long r = std::lrintf(static_cast<float>(v) * job.beta);
+        job.lut[static_cast<size_t>(v)] = static_cast<uchar>(std::clamp<long>(r, 0, 255));
+    }
+    job.row = rowFnFor(isa);
+}
+
+struct LayerJob {
+    cv::Mat* frame;
+    const cv::Mat* color;
+    const cv::Mat* keep;
+    cv::Rect clip;  // in layer coordinates
+    cv::Point at;
+    LayerRowFn row;
+
+    void operator()(int r0, int r1) const {
+        const int cn = frame->channels();
+        for (int r = clip.y + r0; r < clip.y + r1; ++r) {
+            row(frame->ptr<uchar>(at.y + r) + (at.x + clip.x) * cn,
+                color->ptr<uchar>(r) + clip.x * cn, keep->ptr<uchar>(r) + clip.x * cn, clip.width * cn);
+        }
+    }
+};
+
+void prepare(LayerJob& job, cv::Mat& frame, const cv::Mat& color, const cv::Mat& keep, cv::Point at,
+             KernelIsa isa) {
+    CV_Assert(frame.depth() == CV_8U && color.type() == frame.type() && keep.type() == frame.type() &&
+              color.size() == keep.size());
+
+    job.frame = &frame;
+    job.color = &color;
+    job.keep = &keep;
+    job.clip = clipToFrame(frame, color.size(), at);
+    job.at = at;
+    job.row = layerRowFnFor(isa);
+}
+
+// Below this a 4K progress panel still qualifies, a 1080p one does not.
+constexpr size_t kParallelMinBytes = 512u << 10;
+constexpr int kBytesPerTask = 64 << 10;
+
+}  // namespace
+
+KernelIsa bestKernelIsa() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const KernelIsa best = __builtin_cpu_supports("avx2") ? KernelIsa::Avx2
+                                : __builtin_cpu_supports("sse2") ? KernelIsa::Sse2
+                                : KernelIsa::Scalar;
+    return best;
+#else
+    return KernelIsa::Scalar;
+#endif
+}
+
+const char* kernelIsaName(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::Avx2: return "avx2";
+        case KernelIsa::Sse2: return "sse2";
+        default:              return "scalar";
+    }
+}
+
+void darkenInPlaceWith(KernelIsa isa, cv::Mat& roi, double keep) {
+    DarkenJob job;
+    prepare(job, roi, keep, isa);
+    job(0, roi.rows);
+}
+
+void darkenInPlace(cv::Mat& roi, double keep) {
+    DarkenJob job;
+    prepare(job, roi, keep, bestKernelIsa());
+
+    const size_t bytes = static_cast<size_t>(job.rowBytes) * static_cast<size_t>(roi.rows);
+    if (bytes < kParallelMinBytes || job.rowBytes == 0) {
+        job(0, roi.rows);
+        return;
+    }
+    parallelRows(roi.rows, std::max(1, kBytesPerTask / job.rowBytes), job);
+}
+
+void compositeLayerWith(KernelIsa isa, cv::Mat& frame, const cv::Mat& color, const cv::Mat& keep, cv::Point at) {
+    LayerJob job;
+    prepare(job, frame, color, keep, at, isa);
+    job(0, job.clip.height);
+}
+
+void compositeLayer(cv::Mat& frame, const cv::Mat& color, const cv::Mat& keep, cv::Point at) {
+    LayerJob job;
+    prepare(job, frame, color, keep, at, bestKernelIsa());
+
+    const int rowBytes = job.clip.width * frame.channels();
+    const size_t bytes = static_cast<size_t>(rowBytes) * static_cast<size_t>(job.clip.height);
+    if (bytes < kParallelMinBytes || rowBytes == 0) {
+        job(0, job.clip.height);
+        return;
+    }
+    parallelRows(job.clip.height, std::max(1, kBytesPerTask / rowBytes), job);
+}
+
+void blitPremultiplied(cv::Mat& frame, const cv::Mat& bgr, const cv::Mat& alpha, cv::Point at) {
+    const cv::Rect clip = clipToFrame(frame, alpha.size(), at);
+
+    for (int r = clip.y; r < clip.y + clip.height; ++r) {
+        const uchar* a = alpha.ptr<uchar>(r);
+        const uchar* c = bgr.ptr<uchar>(r);
+        uchar* d = frame.ptr<uchar>(at.y + r) + 3 * at.x;
+
+        for (int x = clip.x; x < clip.x + clip.width; ++x) {
+            const int av = a[x];
+            if (av == 0) continue;
+
+            const int inv = 255 - av;
+            for (int k = 0; k < 3; ++k) {
+                const int v = div255(d[3 * x + k] * inv) + c[3 * x + k];
+                d[3 * x + k] = static_cast<uchar>(std::min(v, 255));
+            }
+        }
+    }
+}
+
+void blendSolid(cv::Mat& frame, const cv::Mat& alpha, cv::Point at, const cv::Scalar& color) {
+    const cv::Rect clip = clipToFrame(frame, alpha.size(), at);
+    const int col[3] = {static_cast<int>(color[0]), static_cast<int>(color[1]), static_cast<int>(color[2])};
+
+    for (int r = clip.y; r < clip.y + clip.height; ++r) {
+        const uchar* a = alpha.ptr<uchar>(r);
+        uchar* d = frame.ptr<uchar>(at.y + r) + 3 * at.x;
+
+        for (int x = clip.x; x < clip.x + clip.width; ++x) {
+            const int av = a[x];
+            if (av == 0) continue;
+
+            const int inv = 255 - av;
+            for (int k = 0; k < 3; ++k) {
+                d[3 * x + k] = static_cast<uchar>(div255(d[3 * x + k] * inv + col[k] * av));
+            }
+        }
+    }
+}
+
+void matteToPremultiplied(const cv::Mat& onBlack, const cv::Mat& onWhite,
+                          cv::Mat& bgr, cv::Mat& alpha) {
+    alpha.create(onBlack.rows, onBlack.cols, CV_8UC1);
+    bgr.create(onBlack.rows, onBlack.cols, CV_8UC3);
+
+    // Over black the result is the premultiplied colour; over white it is
+    // that plus (1 - alpha) * 255, so the difference gives the coverage.
+    for (int r = 0; r < onBlack.rows; ++r) {
+        const uchar* b = onBlack.ptr<uchar>(r);
+        const uchar* w = onWhite.ptr<uchar>(r);
+        uchar* a = alpha.ptr<uchar>(r);
+        uchar* c = bgr.ptr<uchar>(r);
+
+        for (int x = 0; x < onBlack.cols; ++x) {
+            const int cov = 255 - std::max(0, w[x] - b[x]);
+            a[x] = static_cast<uchar>(cov);
+            c[3 * x] = c[3 * x + 1] = c[3 * x + 2] = static_cast<uchar>(std::min<int>(b[x], cov));
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#include "render/CueSpriteCache.hpp"
+
+#include <algorithm>
+#include <utility>
+
+static void hashCombine(size_t& seed, size_t v) {
+    seed ^= v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+size_t CueSpriteCache::KeyHash::operator()(const Key& k) const noexcept {
+    size_t h = std::hash<const void*>{}(k.cue.text.data());
+    hashCombine(h, std::hash<int>{}(k.frameWidth));
+
+    const RenderStyle& s = k.style;
+    hashCombine(h, std::hash<double>{}(s.fontScale));
+    hashCombine(h, std::hash<int>{}(s.thickness));
+    hashCombine(h, std::hash<int>{}(s.outlineThickness));
+    hashCombine(h, std::hash<int>{}(s.marginPx));
+    hashCombine(h, std::hash<int>{}(s.lineSpacingPx));
+    hashCombine(h, std::hash<bool>{}(s.drawBox));
+    hashCombine(h, std::hash<double>{}(s.boxAlpha));
+    hashCombine(h, std::hash<int>{}(s.reservedBottomPx));
+    return h;
+}
+
+CueSpriteCache::CueSpriteCache(size_t budgetBytes, Rasterizer rasterize)
+    : budgetBytes_(budgetBytes)
+    , rasterize_(std::move(rasterize))
+{
+    worker_ = std::thread(&CueSpriteCache::workerLoop, this);
+}
+
+CueSpriteCache::~CueSpriteCache() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+std::shared_ptr<const CueSprite>
+CueSpriteCache::get(const CueView& cue, int frameWidth, const RenderStyle& style) {
+    Key key{cue, frameWidth, style};
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (auto hit = findLocked(key)) return hit;
+    }
+
+    auto sprite = std::make_shared<const CueSprite>(rasterize_(cue, frameWidth, style));
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    insertLocked(key, sprite);
+    return sprite;
+}
+
+void CueSpriteCache::prefetch(CueRange cues, int frameWidth, const RenderStyle& style) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        pending_.clear();
+        for (const CueView& cue : cues) {
+            Key key{cue, frameWidth, style};
+            if (index_.find(key) == index_.end()) pending_.push_back(key);
+        }
+        if (pending_.empty()) return;
+    }
+    cv_.notify_one();
+}
+
+size_t CueSpriteCache::bytes() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return bytes_;
+}
+
+std::shared_ptr<const CueSprite> CueSpriteCache::findLocked(const Key& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) return nullptr;
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->sprite;
+}
+
+void CueSpriteCache::insertLocked(const Key& key, std::shared_ptr<const CueSprite> sprite) {
+    // The worker and a render-thread miss may race on the same key.
+    if (index_.find(key) != index_.end()) return;
+
+    bytes_ += sprite->bytes();
+    lru_.push_front(Entry{key, std::move(sprite)});
+    index_.emplace(key, lru_.begin());
+
+    // Sprites still in use by a caller stay alive through their shared_ptr.
+    while (bytes_ > budgetBytes_ && lru_.size() > 1) {
+        Entry& victim = lru_.back();
+        bytes_ -= victim.sprite->bytes();
+        index_.erase(victim.key);
+        lru_.pop_back();
+    }
+}
+
+void CueSpriteCache::workerLoop() {
+    std::unique_lock<std::mutex> lk(mtx_);
+
+    while (true) {
+        cv_.wait(lk, [&] { return stop_ || !pending_.empty(); });
+        if (stop_) return;
+
+        Key key = pending_.front();
+        pending_.pop_front();
+        if (index_.find(key) != index_.end()) continue;
+
+        lk.unlock();
+        auto sprite = std::make_shared<const CueSprite>(rasterize_(key.cue, key.frameWidth, key.style));
+        lk.lock();
+
+        insertLocked(key, std::move(sprite));
+    }
+}
@@ -0,0 +1,43 @@
+#include "render/GlyphAdvanceTable.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+const GlyphAdvanceTable& GlyphAdvanceTable::get(int fontFace, double fontScale, int thickness) {
+    static std::mutex mtx;
+    static std::map<std::tuple<int, double, int>, std::unique_ptr<GlyphAdvanceTable>> tables;
+
+    std::lock_guard<std::mutex> lk(mtx);
+
+    auto& slot = tables[{fontFace, fontScale, thickness}];
+    if (!slot) slot.reset(new GlyphAdvanceTable(fontFace, fontScale, thickness));
+    return *slot;
+}
+
+GlyphAdvanceTable::GlyphAdvanceTable(int fontFace, double fontScale, int thickness)
+    : thickness_(thickness)
+{
+    for (int c = 0; c < 256; ++c) {
+        // At scale 1 and thickness 1 the width is the integer advance plus one.
+        int baseline = 0;
+        const std::string glyph(1, static_cast<char>(c));
+        const int units = cv::getTextSize(glyph, fontFace, 1.0, 1, &baseline).width - 1;
+
+        advance_[static_cast<size_t>(c)] = units * fontScale;
+    }
+}
+
+int GlyphAdvanceTable::widthOf(double sum) const {
+    return cvRound(sum + thickness_);
+}
+
+int GlyphAdvanceTable::textWidth(std::string_view text) const {
+    double sum = 0.0;
+    for (char c : text) sum += advance(static_cast<unsigned char>(c));
+    return widthOf(sum);
+}
@@ -0,0 +1,219 @@
+#include "render/GlyphAtlas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+// Exact x / 255 rounded to nearest for x in [0, 255 * 255].
+static inline int div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static constexpr char32_t kReplacement = 0xFFFD;
+static constexpr char32_t kCyrillicFirst = 0x0410;
+static constexpr int kAtlasWidth = 2048;
+
+// Characters Hershey has no glyph for but subtitles use often.
+static const std::pair<char32_t, std::string_view> kAsciiAliases[] = {
+    {0x00A0, " "},   {0x00AB, "\""},  {0x00BB, "\""},  {0x2010, "-"},   {0x2011, "-"},
+    {0x2012, "-"},   {0x2013, "-"},   {0x2014, "-"},   {0x2018, "'"},   {0x2019, "'"},
+    {0x201A, "'"},   {0x201C, "\""},  {0x201D, "\""},  {0x201E, "\""},  {0x2026, "..."},
+    {0x2116, "N"},   {0x2212, "-"},   {0xFEFF, ""},
+};
+
+const GlyphAtlas& GlyphAtlas::get(double fontScale, int thickness, int outlinePx) {
+    static std::mutex mtx;
+    static std::map<std::tuple<double, int, int>, std::unique_ptr<GlyphAtlas>> atlases;
+
+    std::lock_guard<std::mutex> lk(mtx);
+
+    auto& slot = atlases[{fontScale, thickness, outlinePx}];
+    if (!slot) slot.reset(new GlyphAtlas(fontScale, thickness, outlinePx));
+    return *slot;
+}
+
+GlyphAtlas::GlyphAtlas(double fontScale, int thickness, int outlinePx)
+    : thickness_(thickness)
+{
+    int baseline = 0;
+    const cv::Size simplex = cv::getTextSize("Ag", cv::FONT_HERSHEY_SIMPLEX, fontScale, thickness, &baseline);
+    height_ = simplex.height;
+    baseline_ = baseline;
+
+    int complexBaseline = 0;
+    const cv::Size complex = cv::getTextSize("Ag", cv::FONT_HERSHEY_COMPLEX, fontScale, thickness, &complexBaseline);
+    ascent_ = std::max(simplex.height, complex.height);
+
+    pad_ = thickness + outlinePx + 2;
+    cellHeight_ = ascent_ + std::max(baseline, complexBaseline) + 2 * pad_;
+
+    std::vector<cv::Mat> cells;
+    cells.reserve(160);
+
+    // getTextSize and putText draw bytes outside ' '..'~' as '?'.
+    const Lookup question = add(cv::FONT_HERSHEY_SIMPLEX, "?", fontScale, outlinePx, cells);
+    for (char c = ' '; c < 127; ++c) {
+        ascii_[static_cast<size_t>(c)] = c == '?' ? question
+            : add(cv::FONT_HERSHEY_SIMPLEX, {&c, 1}, fontScale, outlinePx, cells);
+    }
+    for (size_t c = 0; c < ' '; ++c) ascii_[c] = question;
+    ascii_[127] = question;
+    unknown_ = question;
+
+    for (char32_t cp = kCyrillicFirst; cp < kCyrillicFirst + cyrillic_.size(); ++cp) {
+        const char utf8[2] = {static_cast<char>(0xC0 | (cp >> 6)), static_cast<char>(0x80 | (cp & 0x3F))};
+        cyrillic_[cp - kCyrillicFirst] = add(cv::FONT_HERSHEY_COMPLEX, {utf8, 2}, fontScale, outlinePx, cells);
+    }
+
+    // Pack the cells into rows.
+    int x = 0;
+    int y = 0;
+    for (Glyph& g : glyphs_) {
+        if (x + g.cell.width > kAtlasWidth && x > 0) {
+            x = 0;
+            y += cellHeight_;
+        }
+        g.cell.x = x;
+        g.cell.y = y;
+        x += g.cell.width;
+    }
+
+    atlas_.create(y + cellHeight_, kAtlasWidth, CV_8UC2);
+    atlas_.setTo(cv::Scalar::all(0));
+    for (size_t i = 0; i < glyphs_.size(); ++i) cells[i].copyTo(atlas_(glyphs_[i].cell));
+
+    for (const auto& [cp, ascii] : kAsciiAliases) aliases_.emplace_back(cp, alias(ascii));
+    aliases_.emplace_back(0x0401, cyrillic_[0x0415 - kCyrillicFirst]);  // Ё as Е
+    aliases_.emplace_back(0x0451, cyrillic_[0x0435 - kCyrillicFirst]);  // ё as е
+    std::sort(aliases_.begin(), aliases_.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+}
+
+GlyphAtlas::Lookup GlyphAtlas::add(int fontFace, std::string_view utf8, double fontScale, int outlinePx,
+                                   std::vector<cv::Mat>& cells) {
+    const std::string text(utf8);
+
+    // At scale 1 and thickness 1 the width is the integer advance plus one.
+    int baseline = 0;
+    const int units = cv::getTextSize(text, fontFace, 1.0, 1, &baseline).width - 1;
+
+    Glyph g;
+    g.advance = units * fontScale;
+    g.cell = {0, 0, cvCeil(g.advance) + thickness_ + 2 * pad_, cellHeight_};
+
+    cv::Mat fill(g.cell.size(), CV_8UC1, cv::Scalar(0));
+    cv::putText(fill, text, {pad_, pad_ + ascent_}, fontFace, fontScale, cv::Scalar(255), thickness_, cv::LINE_AA);
+
+    cv::Mat outline;
+    const int k = 2 * outlinePx + 1;
+    cv::dilate(fill, outline, cv::getStructuringElement(cv::MORPH_ELLIPSE, {k, k}));
+    g.blank = cv::countNonZero(outline) == 0;
+
+    cv::Mat cell;
+    const cv::Mat planes[] = {fill, outline};
+    cv::merge(planes, 2, cell);
+    cells.push_back(std::move(cell));
+
+    glyphs_.push_back(g);
+    return {static_cast<uint16_t>(glyphs_.size() - 1), 1};
+}
+
+// Appends copies of the ASCII glyphs spelling `ascii`, so the alias is one
+// contiguous run.
+GlyphAtlas::Lookup GlyphAtlas::alias(std::string_view ascii) {
+    if (ascii.size() == 1) return ascii_[static_cast<unsigned char>(ascii[0])];
+
+    const Lookup l{static_cast<uint16_t>(glyphs_.size()), static_cast<uint8_t>(ascii.size())};
+    for (char c : ascii) {
+        const Glyph copy = glyphs_[ascii_[static_cast<unsigned char>(c)].first];
+        glyphs_.push_back(copy);
+    }
+    return l;
+}
+
+char32_t GlyphAtlas::decode(std::string_view text, size_t& i) {
+    const auto lead = static_cast<unsigned char>(text[i++]);
+    if (lead < 0x80) return lead;
+
+    int extra = 0;
+    char32_t cp = 0;
+    if ((lead & 0xE0) == 0xC0) {
+        extra = 1;
+        cp = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+        extra = 2;
+        cp = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+        extra = 3;
+        cp = lead & 0x07;
+    } else {
+        return kReplacement;
+    }
+
+    if (i + static_cast<size_t>(extra) > text.size()) return kReplacement;
+    for (int k = 0; k < extra; ++k) {
+        const auto b = static_cast<unsigned char>(text[i + static_cast<size_t>(k)]);
+        if ((b & 0xC0) != 0x80) return kReplacement;
+        cp = (cp << 6) | (b & 0x3F);
+    }
+    i += static_cast<size_t>(extra);
+    return cp;
+}
+
+GlyphAtlas::Lookup GlyphAtlas::lookup(char32_t cp) const {
+    if (cp < ascii_.size()) return ascii_[cp];
+    if (cp >= kCyrillicFirst && cp < kCyrillicFirst + cyrillic_.size()) return cyrillic_[cp - kCyrillicFirst];
+
+    const auto it = std::lower_bound(aliases_.begin(), aliases_.end(), cp,
+                                     [](const auto& a, char32_t v) { return a.first < v; });
+    return it != aliases_.end() && it->first == cp ? it->second : unknown_;
+}
+
+int GlyphAtlas::textWidth(std::string_view text) const {
+    double sum = 0.0;
+    forEachGlyph(text, [&](const Glyph& g) { sum += g.advance; });
+    return widthOf(sum);
+}
+
+// Composites one channel of a cell: channel 1 blends black through the
+// outline, channel 0 white through the fill.
+static void blendCell(cv::Mat& lum, cv::Mat& alpha, const cv::Mat& atlas, cv::Rect cell, cv::Point at,
+                      int channel) {
+    const int c0 = std::max(0, -at.x);
+    const int r0 = std::max(0, -at.y);
+    const int c1 = std::min(cell.width, lum.cols - at.x);
+    const int r1 = std::min(cell.height, lum.rows - at.y);
+
+    for (int r = r0; r < r1; ++r) {
+        const uchar* src = atlas.ptr<uchar>(cell.y + r) + 2 * cell.x + channel;
+        uchar* l = lum.ptr<uchar>(at.y + r) + at.x;
+        uchar* a = alpha.ptr<uchar>(at.y + r) + at.x;
+
+        for (int x = c0; x < c1; ++x) {
+            const int v = src[2 * x];
+            if (v == 0) continue;
+
+            a[x] = static_cast<uchar>(a[x] + div255((255 - a[x]) * v));
+            l[x] = static_cast<uchar>(channel == 1 ? div255(l[x] * (255 - v))
+                                                   : l[x] + div255((255 - l[x]) * v));
+        }
+    }
+}
+
+void GlyphAtlas::draw(cv::Mat& lum, cv::Mat& alpha, std::string_view text, cv::Point org) const {
+    CV_Assert(lum.type() == CV_8UC1 && alpha.type() == CV_8UC1 && lum.size() == alpha.size());
+
+    for (int channel : {1, 0}) {
+        double x = org.x;
+        forEachGlyph(text, [&](const Glyph& g) {
+            const cv::Point at(static_cast<int>(std::lround(x)) - pad_, org.y - ascent_ - pad_);
+            if (!g.blank) blendCell(lum, alpha, atlas_, g.cell, at, channel);
+            x += g.advance;
+        });
+    }
+}
@@ -0,0 +1,40 @@
+#include "render/GlyphStamps.hpp"
+
+#include "render/BlendKernels.hpp"
+
+#include <cmath>
+#include <string>
+
+GlyphStamps::GlyphStamps(int fontFace, double fontScale, int thickness)
+    : advances_(GlyphAdvanceTable::get(fontFace, fontScale, thickness))
+    , fontScale_(fontScale)
+{
+    int baseline = 0;
+    const cv::Size box = cv::getTextSize("Ag", fontFace, fontScale, thickness, &baseline);
+
+    pad_ = thickness + 2;
+    ascent_ = box.height;
+    const int height = box.height + baseline + 2 * pad_;
+
+    for (int c = 0; c < 256; ++c) {
+        const std::string glyph(1, static_cast<char>(c));
+        const int width = advances_.textWidth(glyph) + 2 * pad_;
+
+        cv::Mat& stamp = stamps_[static_cast<size_t>(c)];
+        stamp.create(height, width, CV_8UC1);
+        stamp.setTo(cv::Scalar(0));
+        cv::putText(stamp, glyph, {pad_, pad_ + ascent_},
+                    fontFace, fontScale, cv::Scalar(255), thickness, cv::LINE_AA);
+    }
+}
+
+void GlyphStamps::draw(cv::Mat& frame, std::string_view text, cv::Point org, const cv::Scalar& color) const {
+    double x = org.x;
+    for (char ch : text) {
+        const auto c = static_cast<unsigned char>(ch);
+        const cv::Point at(static_cast<int>(std::lround(x)) - pad_, org.y - ascent_ - pad_);
+
+        if (c != ' ') blendSolid(frame, stamps_[c], at, color);
+        x += advances_.advance(c);
+    }
+}
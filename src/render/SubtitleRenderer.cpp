@@ -1,41 +1,131 @@
 #include "render/SubtitleRenderer.hpp"
 
+#include "render/BlendKernels.hpp"
+#include "render/GlyphAtlas.hpp"
+
 #include <opencv2/opencv.hpp>
 
 #include <algorithm>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
-static cv::Scalar white() { return {255, 255, 255}; }
-static cv::Scalar black() { return {0, 0, 0}; }
+static constexpr int kSafeGap = 6;
+
+SubtitleRenderer::SubtitleRenderer(RenderStyle style, size_t spriteBudgetBytes)
+    : baseStyle_(style)
+    , style_(style)
+    , cache_(std::make_unique<CueSpriteCache>(
+          spriteBudgetBytes,
+          [](const CueView& cue, int frameWidth, const RenderStyle& style) {
+              return rasterize(style, cue, frameWidth);
+          })) {}
+
+// outlineThickness is the stroke width of the outline pass around a glyph
+// drawn `thickness` wide; the atlas grows the glyph by half the difference.
+static const GlyphAtlas& atlasFor(const RenderStyle& style) {
+    const int outlinePx = std::max(1, (style.outlineThickness - style.thickness + 1) / 2);
+    return GlyphAtlas::get(style.fontScale, style.thickness, outlinePx);
+}
 
-SubtitleRenderer::SubtitleRenderer(RenderStyle style)
-    : style_(style) {}
+static bool isWrapSpace(char c) {
+    // Same set std::istream >> std::string splits on in the "C" locale.
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
 
-void SubtitleRenderer::drawOutlinedText(cv::Mat& frame,
-                                       const std::string& text,
-                                       cv::Point org,
-                                       double scale,
-                                       int thickness) {
-    cv::putText(frame, text, org,
-                cv::FONT_HERSHEY_SIMPLEX,
-                scale, black(),
-                thickness + 2, cv::LINE_AA);
+// Copies [words] into a string, collapsing each whitespace run to one space.
+static std::string joinWords(std::string_view words) {
+    std::string out;
+    out.reserve(words.size());
 
-    cv::putText(frame, text, org,
-                cv::FONT_HERSHEY_SIMPLEX,
-                scale, white(),
-                thickness, cv::LINE_AA);
+    bool gap = false;
+    for (char c : words) {
+        if (isWrapSpace(c)) {
+            gap = true;
+            continue;
+        }
+        if (gap) out.push_back(' ');
+        gap = false;
+        out.push_back(c);
+    }
+    return out;
 }
 
-std::vector<std::string>
-SubtitleRenderer::wrapLines(const std::vector<std::string>& lines,
-                            int maxWidthPx) const {
-    std::vector<std::string> result;
+void SubtitleRenderer::wrapLines(const RenderStyle& style,
+                                 const CueView& cue,
+                                 int maxWidthPx,
+                                 std::vector<std::string>& result) {
+    const GlyphAtlas& glyphs = atlasFor(style);
+    double space = 0.0;
+    glyphs.forEachGlyph(" ", [&](const GlyphAtlas::Glyph& g) { space += g.advance; });
+
+#ifdef SUBPLAYER_VERIFY_WRAP
+    const size_t firstOut = result.size();
+#endif
+
+    cue.forEachLine([&](std::string_view sv) {
+        // The current line is sv[curBegin, curEnd) with advances adding up to
+        // curSum, accumulated in the order getTextSize would add them.
+        size_t curBegin = 0;
+        size_t curEnd = 0;
+        double curSum = 0.0;
+        bool haveCurrent = false;
+
+        size_t i = 0;
+        while (true) {
+            while (i < sv.size() && isWrapSpace(sv[i])) ++i;
+            if (i == sv.size()) break;
+
+            const size_t wordBegin = i;
+            double wordSum = 0.0;
+            double testSum = curSum + space;
+            while (i < sv.size() && !isWrapSpace(sv[i])) ++i;
+            glyphs.forEachGlyph(sv.substr(wordBegin, i - wordBegin), [&](const GlyphAtlas::Glyph& g) {
+                wordSum += g.advance;
+                testSum += g.advance;
+            });
+
+            if (!haveCurrent) testSum = wordSum;
+
+            if (glyphs.widthOf(testSum) <= maxWidthPx) {
+                if (!haveCurrent) curBegin = wordBegin;
+                curEnd = i;
+                curSum = testSum;
+            } else {
+                if (haveCurrent) result.push_back(joinWords(sv.substr(curBegin, curEnd - curBegin)));
+                curBegin = wordBegin;
+                curEnd = i;
+                curSum = wordSum;
+            }
+            haveCurrent = true;
+        }
+
+        if (haveCurrent) result.push_back(joinWords(sv.substr(curBegin, curEnd - curBegin)));
+    });
+
+#ifdef SUBPLAYER_VERIFY_WRAP
+    // getTextSize measures bytes, so only ASCII cues can be compared.
+    const auto nonAscii = [](char c) { return static_cast<unsigned char>(c) >= 0x80; };
+    if (std::any_of(cue.text.begin(), cue.text.end(), nonAscii)) return;
+    std::vector<std::string> reference;
+    wrapLinesReference(style, cue, maxWidthPx, reference);
+    if (!std::equal(result.begin() + static_cast<std::ptrdiff_t>(firstOut), result.end(),
+                    reference.begin(), reference.end())) {
+        throw std::logic_error("wrapLines diverged from the getTextSize reference");
+    }
+#endif
+}
 
-    for (const std::string& line : lines) {
-        std::istringstream iss(line);
+#ifdef SUBPLAYER_VERIFY_WRAP
+// The original quadratic wrapper, kept to cross-check the glyph-table path.
+void SubtitleRenderer::wrapLinesReference(const RenderStyle& style,
+                                          const CueView& cue,
+                                          int maxWidthPx,
+                                          std::vector<std::string>& result) {
+    cue.forEachLine([&](std::string_view line) {
+        std::istringstream iss{std::string(line)};
         std::string word;
         std::string current;
 
@@ -46,8 +136,8 @@ SubtitleRenderer::wrapLines(const std::vector<std::string>& lines,
             cv::Size sz = cv::getTextSize(
                 test,
                 cv::FONT_HERSHEY_SIMPLEX,
-                style_.fontScale,
-                style_.thickness,
+                style.fontScale,
+                style.thickness,
                 &baseline
             );
 
@@ -60,91 +150,152 @@ SubtitleRenderer::wrapLines(const std::vector<std::string>& lines,
         }
 
         if (!current.empty()) result.push_back(current);
-    }
-
-    return result;
+    });
+}
+#endif
+
+// Lays black at `boxAlpha` over what is already in the block. Both planes go
+// through darkenInPlace, so the box keeps the addWeighted rounding the
+// on-black / on-white matte produced: lum is darkened directly and the
+// coverage as 255 - darken(255 - alpha).
+static void shadeBox(cv::Mat& lum, cv::Mat& alpha, cv::Rect box, double boxAlpha) {
+    if (box.width <= 0 || box.height <= 0) return;
+
+    cv::Mat lumRoi = lum(box);
+    darkenInPlace(lumRoi, 1.0 - boxAlpha);
+
+    cv::Mat alphaRoi = alpha(box);
+    cv::bitwise_not(alphaRoi, alphaRoi);
+    darkenInPlace(alphaRoi, 1.0 - boxAlpha);
+    cv::bitwise_not(alphaRoi, alphaRoi);
 }
 
-void SubtitleRenderer::draw(cv::Mat& frame, const SubtitleCue& cue) const {
-    if (frame.empty()) return;
+CueSprite SubtitleRenderer::rasterize(const RenderStyle& style,
+                                      const CueView& cue,
+                                      int frameWidth) {
+    CueSprite sprite;
 
-    const int maxWidth = frame.cols - 2 * style_.marginPx;
-    if (maxWidth <= 0) return;
+    const int maxWidth = frameWidth - 2 * style.marginPx;
+    if (maxWidth <= 0) return sprite;
 
-    std::vector<std::string> lines = wrapLines(cue.lines, maxWidth);
-    if (lines.empty()) return;
+    std::vector<std::string> lines;
+    wrapLines(style, cue, maxWidth, lines);
+    if (lines.empty()) return sprite;
 
-    int baseline = 0;
+    const GlyphAtlas& glyphs = atlasFor(style);
+    const int baseline = glyphs.baseline();
     std::vector<cv::Size> sizes;
     sizes.reserve(lines.size());
 
     int totalHeight = 0;
+    int advance = 0;
+    int left = frameWidth;
+    int right = 0;
+
+    // Room for the outline stroke and descenders around the text boxes.
+    const int margin = style.thickness + 4;
+
     for (const auto& l : lines) {
-        cv::Size sz = cv::getTextSize(
-            l,
-            cv::FONT_HERSHEY_SIMPLEX,
-            style_.fontScale,
-            style_.thickness,
-            &baseline
-        );
+        const cv::Size sz(glyphs.textWidth(l), glyphs.height());
         sizes.push_back(sz);
-        totalHeight += sz.height + style_.lineSpacingPx;
+        totalHeight += sz.height + style.lineSpacingPx;
+        advance += sz.height + 2 * kBoxPadY + style.lineSpacingPx;
+
+        const int xText = (frameWidth - sz.width) / 2;
+        const int x0 = style.drawBox ? xText - kBoxPadX : xText - margin;
+        const int x1 = style.drawBox ? xText + sz.width + kBoxPadX : xText + sz.width + margin;
+        left = std::min(left, x0);
+        right = std::max(right, x1);
     }
-    totalHeight -= style_.lineSpacingPx;
+    totalHeight -= style.lineSpacingPx;
 
-    const int safeGap = 6; 
-    int yStart = frame.rows - style_.marginPx - style_.reservedBottomPx - safeGap - totalHeight;
+    left = std::max(0, left - margin);
+    right = std::min(frameWidth, right + margin);
+    if (right <= left) return sprite;
 
-    if (yStart < style_.marginPx) yStart = style_.marginPx;
+    const int height = advance - style.lineSpacingPx + baseline + 2 * margin;
+    const int width = right - left;
 
-    const int padX = 18;
-    const int padY = 4;
-    const int gap = style_.lineSpacingPx;
+    // The block is grey, so it is composed as one premultiplied plane plus
+    // alpha and only expanded to BGR at the end.
+    cv::Mat lum(height, width, CV_8UC1, cv::Scalar(0));
+    cv::Mat alpha(height, width, CV_8UC1, cv::Scalar(0));
 
-    int y = yStart; 
+    const int gap = style.lineSpacingPx;
+    int y = margin;
 
     for (size_t i = 0; i < lines.size(); ++i) {
         const cv::Size sz = sizes[i];
 
-        const int boxH = sz.height + 2 * padY;
+        const int boxH = sz.height + 2 * kBoxPadY;
+        const int yBase = y + kBoxPadY + sz.height;
+        const int xText = (frameWidth - sz.width) / 2 - left;
 
-        const int yBase = y + padY + sz.height;
+        if (style.drawBox) {
+            const cv::Rect box = cv::Rect(xText - kBoxPadX, y, sz.width + 2 * kBoxPadX, boxH) &
+                                 cv::Rect(0, 0, width, height);
+            shadeBox(lum, alpha, box, style.boxAlpha);
+        }
 
-        int xText = (frame.cols - sz.width) / 2;
+        glyphs.draw(lum, alpha, lines[i], {xText, yBase});
 
-        if (style_.drawBox) {
-            int boxX = xText - padX;
-            int boxW = sz.width + 2 * padX;
+        y += boxH + gap;
+    }
 
-            int boxTop = y;
+    cv::cvtColor(lum, sprite.bgr, cv::COLOR_GRAY2BGR);
+    sprite.alpha = alpha;
 
-            if (boxX < 0) { boxW += boxX; boxX = 0; }
-            if (boxX + boxW > frame.cols) boxW = frame.cols - boxX;
+    sprite.x = left;
+    sprite.top = -margin;
+    sprite.layoutHeight = totalHeight;
+    sprite.advance = advance;
+    return sprite;
+}
 
-            int boxHClamped = boxH;
-            int boxTopClamped = boxTop;
-            if (boxTopClamped < 0) { boxHClamped += boxTopClamped; boxTopClamped = 0; }
-            if (boxTopClamped + boxHClamped > frame.rows) boxHClamped = frame.rows - boxTopClamped;
+void SubtitleRenderer::draw(cv::Mat& frame, const CueView& cue) const {
+    draw(frame, std::span<const CueView>(&cue, 1));
+}
 
-            if (boxW > 0 && boxHClamped > 0) {
-                cv::Rect box(boxX, boxTopClamped, boxW, boxHClamped);
+void SubtitleRenderer::draw(cv::Mat& frame, std::span<const CueView> cues) const {
+    if (frame.empty()) return;
+    CV_Assert(frame.type() == CV_8UC3);
 
-                cv::Mat roi = frame(box);
-                cv::Mat overlay = roi.clone();
-                overlay.setTo(cv::Scalar(0, 0, 0));
+    frameSprites_.clear();
 
-                cv::addWeighted(overlay, style_.boxAlpha,
-                                roi, 1.0 - style_.boxAlpha,
-                                0.0, roi);
-            }
-        }
+    int totalHeight = 0;
+    for (const CueView& cue : cues) {
+        auto sprite = cache_->get(cue, frame.cols, style_);
+        if (sprite->empty()) continue;
 
-        drawOutlinedText(frame, lines[i], {xText, yBase},
-                        style_.fontScale, style_.thickness);
+        if (!frameSprites_.empty()) totalHeight += style_.lineSpacingPx;
+        totalHeight += sprite->layoutHeight;
+        frameSprites_.push_back(std::move(sprite));
+    }
+    if (frameSprites_.empty()) return;
 
-        y += boxH + gap;
+    int y = frame.rows - style_.marginPx - style_.reservedBottomPx - kSafeGap - totalHeight;
+    if (y < style_.marginPx) y = style_.marginPx;
 
+    for (const auto& sprite : frameSprites_) {
         if (y >= frame.rows) break;
+        blitPremultiplied(frame, sprite->bgr, sprite->alpha, {sprite->x, y + sprite->top});
+        y += sprite->advance;
     }
 
+    frameSprites_.clear();
+}
+
+void SubtitleRenderer::setScale(double k) {
+    if (k == scale_) return;
+    scale_ = k;
+    style_ = k == 1.0 ? baseStyle_ : baseStyle_.scaled(k);
+}
+
+void SubtitleRenderer::prefetch(CueRange upcoming, int frameWidth) const {
+    const char* head = upcoming.empty() ? nullptr : upcoming.front().text.data();
+    if (head == lastPrefetch_ && frameWidth == lastPrefetchWidth_) return;
+
+    lastPrefetch_ = head;
+    lastPrefetchWidth_ = frameWidth;
+    if (head) cache_->prefetch(upcoming, frameWidth, style_);
 }
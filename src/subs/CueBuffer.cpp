@@ -0,0 +1,44 @@
+#include "subs/CueBuffer.hpp"
+
+void CueBuffer::addLine(std::string_view line) {
+    if (pendingLines_) text_.push_back('\n');
+    text_.insert(text_.end(), line.begin(), line.end());
+    pendingLines_ = true;
+}
+
+bool CueBuffer::commit(int64_t start_ms, int64_t end_ms) {
+    if (!pendingLines_) return false;
+    pendingLines_ = false;
+
+    start_.push_back(start_ms);
+    end_.push_back(end_ms);
+    textBegin_.push_back(text_.size());
+    return true;
+}
+
+void CueBuffer::append(const CueView& cue) {
+    start_.push_back(cue.start_ms);
+    end_.push_back(cue.end_ms);
+    text_.insert(text_.end(), cue.text.begin(), cue.text.end());
+    textBegin_.push_back(text_.size());
+}
+
+void CueBuffer::append(const CueBuffer& other) {
+    const uint64_t shift = text_.size();
+    start_.insert(start_.end(), other.start_.begin(), other.start_.end());
+    end_.insert(end_.end(), other.end_.begin(), other.end_.end());
+    for (size_t i = 1; i < other.textBegin_.size(); ++i) textBegin_.push_back(other.textBegin_[i] + shift);
+    text_.insert(text_.end(), other.text_.begin(), other.text_.end());
+}
+
+void CueBuffer::reserve(size_t cues, size_t textBytes) {
+    start_.reserve(cues);
+    end_.reserve(cues);
+    textBegin_.reserve(cues + 1);
+    text_.reserve(textBytes);
+}
+
+size_t CueBuffer::bytes() const noexcept {
+    return start_.capacity() * sizeof(int64_t) + end_.capacity() * sizeof(int64_t) +
+           textBegin_.capacity() * sizeof(uint64_t) + text_.capacity();
+}
@@ -1,14 +1,68 @@
 #include "subs/SrtParser.hpp"
 
+#include "io/MappedFile.hpp"
+#include "util/WorkStealingPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 static void drop_cr(std::string& line) {
     if (!line.empty() && line.back() == '\r') line.pop_back();
 }
 
+namespace {
+
+// Splits a buffer into lines exactly like std::getline followed by drop_cr,
+// but hands out views into the buffer instead of copies.
+class LineScanner {
+public:
+    explicit LineScanner(std::string_view data, size_t offset = 0)
+        : base_(data.data()), p_(data.data() + offset), end_(data.data() + data.size()) {}
+
+    size_t offset() const { return static_cast<size_t>(p_ - base_); }
+
+    bool next(std::string_view& line) {
+        if (p_ == end_) return false;
+
+        const auto* nl = static_cast<const char*>(
+            std::memchr(p_, '\n', static_cast<size_t>(end_ - p_)));
+        const char* stop = nl ? nl : end_;
+
+        line = std::string_view(p_, static_cast<size_t>(stop - p_));
+        p_ = nl ? nl + 1 : end_;
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return true;
+    }
+
+private:
+    const char* base_;
+    const char* p_;
+    const char* end_;
+};
+
+size_t findArrow(std::string_view s) {
+    const char* p = s.data();
+    const char* end = s.data() + s.size();
+
+    while (end - p >= 3) {
+        const auto* d = static_cast<const char*>(
+            std::memchr(p, '-', static_cast<size_t>(end - p - 2)));
+        if (!d) break;
+        if (d[1] == '-' && d[2] == '>') return static_cast<size_t>(d - s.data());
+        p = d + 1;
+    }
+    return std::string_view::npos;
+}
+
+}  // namespace
+
 std::string SrtParser::trim(std::string s) {
     auto is_space = [](unsigned char c) { return c == ' ' || c == '\t'; };
 
@@ -21,6 +75,18 @@ std::string SrtParser::trim(std::string s) {
     return s.substr(l, r - l);
 }
 
+std::string_view SrtParser::trimView(std::string_view s) {
+    auto is_space = [](unsigned char c) { return c == ' ' || c == '\t'; };
+
+    size_t l = 0;
+    while (l < s.size() && is_space(static_cast<unsigned char>(s[l]))) ++l;
+
+    size_t r = s.size();
+    while (r > l && is_space(static_cast<unsigned char>(s[r - 1]))) --r;
+
+    return s.substr(l, r - l);
+}
+
 int64_t SrtParser::parseTimeMs(std::string_view s) {
     if (s.size() < 12) throw std::runtime_error("Bad time format");
 
@@ -55,57 +121,293 @@ int64_t SrtParser::parseTimeMs(std::string_view s) {
 }
 
 SubtitleTrack SrtParser::parseFile(const std::filesystem::path& path) const {
+    MappedFile file = [&] {
+        try {
+            return MappedFile(path);
+        } catch (const std::exception&) {
+            throw std::runtime_error("Cannot open SRT: " + path.string());
+        }
+    }();
+    return parseBuffer(file.view());
+}
+
+SubtitleTrack SrtParser::parseFileCached(const std::filesystem::path& path) const {
+    if (auto cached = SubtitleTrack::loadCache(path)) return std::move(*cached);
+
+    SubtitleTrack track = parseFile(path);
+    track.saveCache(path);
+    return track;
+}
+
+SubtitleTrack SrtParser::parseBuffer(std::string_view data) const {
+    const unsigned threads = threads_ ? threads_ : std::max(1u, std::thread::hardware_concurrency());
+    if (threads > 1 && data.size() >= kParallelMinBytes) return parseParallel(data, threads);
+
+    CueBuffer cues;
+    // Typical SRT: ~60 bytes per cue, about two thirds of it text.
+    cues.reserve(data.size() / 60, data.size() * 2 / 3);
+    parseCues(data, 0, SIZE_MAX, cues);
+    return SubtitleTrack(std::move(cues));
+}
+
+SubtitleTrack SrtParser::parseParallel(std::string_view data, unsigned threads) const {
+    // A few ranges per thread so one slow range doesn't hold up the rest.
+    const size_t wanted = size_t{threads} * 4;
+
+    std::vector<size_t> bounds{0};
+    for (size_t k = 1; k < wanted; ++k) {
+        size_t at = 0;
+        int64_t start = 0;
+        if (!nextCueAt(data, data.size() / wanted * k, at, start)) break;
+        if (at > bounds.back()) bounds.push_back(at);
+    }
+    bounds.push_back(SIZE_MAX);
+
+    struct Part {
+        CueBuffer cues;
+        size_t first = 0;  // first non-blank line at or after the range start
+        size_t stop = 0;   // where parsing stopped
+        std::exception_ptr error;
+    };
+    std::vector<Part> parts(bounds.size() - 1);
+
+    {
+        WorkStealingPool pool(std::min<unsigned>(threads, static_cast<unsigned>(parts.size())));
+        for (size_t k = 0; k < parts.size(); ++k) {
+            pool.submit([&, k] {
+                Part& part = parts[k];
+                try {
+                    LineScanner scanner(data, bounds[k]);
+                    std::string_view line;
+                    part.first = scanner.offset();
+                    while (scanner.next(line) && trimView(line).empty()) part.first = scanner.offset();
+
+                    const size_t span = std::min(bounds[k + 1], data.size()) - bounds[k];
+                    part.cues.reserve(span / 60, span * 2 / 3);
+                    part.stop = parseRange(data, bounds[k], bounds[k + 1], SIZE_MAX, part.cues);
+                } catch (...) {
+                    part.error = std::current_exception();
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    // Range k is only valid if the parse of range k - 1 stopped exactly at
+    // its first cue, i.e. the sequential parser would be between cues there.
+    // Pathological input (blank lines inside a cue's header) fails that
+    // check, and the rest is parsed sequentially instead.
+    CueBuffer cues;
+    size_t total = 0;
+    for (const Part& part : parts) total += part.cues.size();
+    cues.reserve(total, data.size());
+
+    for (size_t k = 0; k < parts.size(); ++k) {
+        Part& part = parts[k];
+        if (k > 0 && parts[k - 1].stop != part.first) {
+            parseCues(data, parts[k - 1].stop, SIZE_MAX, cues);
+            break;
+        }
+        if (part.error) std::rethrow_exception(part.error);
+        cues.append(part.cues);
+        part.cues = CueBuffer();
+    }
+
+    // Ranges are in file order, so the track's start-order check usually
+    // passes and no sort runs.
+    return SubtitleTrack(std::move(cues));
+}
+
+size_t SrtParser::parseCues(std::string_view data, size_t offset, size_t maxCues,
+                            CueBuffer& cues) const {
+    return parseRange(data, offset, SIZE_MAX, maxCues, cues);
+}
+
+void SrtParser::fail(std::string_view data, size_t lineAt, const std::string& reason) {
+    // Counted only on failure, from the start of the data, so ranges parsed
+    // on other threads report the same line as a sequential parse.
+    const size_t line = 1 + static_cast<size_t>(std::count(data.begin(), data.begin() + lineAt, '\n'));
+    throw ParseError(line, reason);
+}
+
+size_t SrtParser::parseRange(std::string_view data, size_t offset, size_t stopAt, size_t maxCues,
+                             CueBuffer& cues) const {
+    LineScanner scanner(data, offset);
+    std::string_view line;
+    size_t kept = 0;
+
+    while (kept < maxCues) {
+        std::string_view s;
+        size_t cueAt = scanner.offset();
+        bool found = false;
+        while (scanner.next(s)) {
+            if (!trimView(s).empty()) {
+                found = true;
+                break;
+            }
+            cueAt = scanner.offset();
+        }
+        if (!found) break;
+        if (cueAt >= stopAt) return cueAt;
+
+        const size_t nextAt = scanner.offset();
+        std::string_view timeLine;
+        if (!scanner.next(timeLine)) fail(data, cueAt, "Unexpected EOF after cue index");
+
+        // Same quirk as the stream parser: a cue without an index line
+        // consumes (and drops) the line following its timeline.
+        size_t timeAt = nextAt;
+        if (findArrow(s) != std::string_view::npos) {
+            timeLine = s;
+            timeAt = cueAt;
+        }
+
+        size_t arrow = findArrow(timeLine);
+        if (arrow == std::string_view::npos)
+            fail(data, timeAt, "Bad timeline line: " + std::string(timeLine));
+
+        int64_t start = 0;
+        int64_t end = 0;
+        try {
+            start = parseTimeMs(trimView(timeLine.substr(0, arrow)));
+            end = parseTimeMs(trimView(timeLine.substr(arrow + 3)));
+        } catch (const std::runtime_error& e) {
+            fail(data, timeAt, e.what());
+        }
+        if (end < start) fail(data, timeAt, "Cue end < start");
+
+        while (scanner.next(line)) {
+            std::string_view t = trimView(line);
+            if (t.empty()) break;
+            cues.addLine(t);
+        }
+
+        if (cues.commit(start, end)) ++kept;
+    }
+
+    return scanner.offset();
+}
+
+bool SrtParser::nextCueAt(std::string_view data, size_t from, size_t& offset, int64_t& startMs) {
+    // Start on a line boundary.
+    if (from > 0) {
+        const size_t nl = data.find('\n', from - 1);
+        if (nl == std::string_view::npos) return false;
+        from = nl + 1;
+    }
+
+    // A cue is a blank line (or the start of the data), an index line of
+    // digits, then a timeline.
+    LineScanner scanner(data, from);
+    std::string_view prev1, line;
+    size_t prev1At = from;
+    bool prev2Blank = from == 0;
+    bool havePrev1 = false;
+
+    for (size_t at = scanner.offset(); scanner.next(line); at = scanner.offset()) {
+        if (havePrev1 && findArrow(line) != std::string_view::npos) {
+            const std::string_view index = trimView(prev1);
+            const bool digits = !index.empty() &&
+                index.find_first_not_of("0123456789") == std::string_view::npos;
+            if (digits && prev2Blank) {
+                try {
+                    startMs = parseTimeMs(trimView(line.substr(0, findArrow(line))));
+                    offset = prev1At;
+                    return true;
+                } catch (const std::exception&) {
+                    // Not a usable timeline; keep looking.
+                }
+            }
+        }
+        prev2Blank = havePrev1 ? trimView(prev1).empty() : prev2Blank;
+        prev1 = line;
+        prev1At = at;
+        havePrev1 = true;
+    }
+    return false;
+}
+
+size_t SrtParser::cueOffsetBefore(std::string_view data, int64_t t_ms) const {
+    size_t lo = 0;
+    size_t hi = data.size();
+
+    while (hi - lo > kProbeGranularity) {
+        const size_t mid = lo + (hi - lo) / 2;
+        size_t at = 0;
+        int64_t start = 0;
+        if (nextCueAt(data, mid, at, start) && start <= t_ms) lo = mid;
+        else hi = mid;
+    }
+
+    size_t at = 0;
+    int64_t start = 0;
+    if (lo == 0 || !nextCueAt(data, lo, at, start)) return 0;
+    return at;
+}
+
+SubtitleTrack SrtParser::parseFileStream(const std::filesystem::path& path) const {
     std::ifstream in(path);
     if (!in) throw std::runtime_error("Cannot open SRT: " + path.string());
 
-    std::vector<SubtitleCue> cues;
+    CueBuffer cues;
     std::string line;
+    size_t lineNo = 0;  // of the last line read, 1-based
 
     while (true) {
         std::string s;
         while (std::getline(in, s)) {
+            ++lineNo;
             drop_cr(s);
             if (!trim(s).empty()) break;
         }
         if (!in) break; 
+        const size_t cueLine = lineNo;
 
         std::string timeLine;
         if (!std::getline(in, timeLine))
-            throw std::runtime_error("Unexpected EOF after cue index");
+            throw ParseError(cueLine, "Unexpected EOF after cue index");
+        ++lineNo;
         drop_cr(timeLine);
 
         bool s_is_timeline = (s.find("-->") != std::string::npos);
+        size_t timeLineNo = lineNo;
         if (s_is_timeline) {
             timeLine = s;
+            timeLineNo = cueLine;
         }
 
         auto arrow = timeLine.find("-->");
         if (arrow == std::string::npos)
-            throw std::runtime_error("Bad timeline line: " + timeLine);
+            throw ParseError(timeLineNo, "Bad timeline line: " + timeLine);
 
         std::string left = trim(timeLine.substr(0, arrow));
         std::string right = trim(timeLine.substr(arrow + 3));
 
-        int64_t start = parseTimeMs(left);
-        int64_t end = parseTimeMs(right);
-        if (end < start) throw std::runtime_error("Cue end < start");
-
-        std::vector<std::string> lines;
+        int64_t start = 0;
+        int64_t end = 0;
+        try {
+            start = parseTimeMs(left);
+            end = parseTimeMs(right);
+        } catch (const std::runtime_error& e) {
+            throw ParseError(timeLineNo, e.what());
+        }
+        if (end < start) throw ParseError(timeLineNo, "Cue end < start");
 
         if (!s_is_timeline) {
             std::string firstText = trim(timeLine);
             if (!firstText.empty() && firstText.find("-->") == std::string::npos)
-                lines.push_back(firstText);
+                cues.addLine(firstText);
         }
 
         while (std::getline(in, line)) {
+            ++lineNo;
             drop_cr(line);
             std::string t = trim(line);
             if (t.empty()) break;
-            lines.push_back(t);
+            cues.addLine(t);
         }
 
-        if (!lines.empty()) cues.push_back(SubtitleCue{start, end, std::move(lines)});
+        cues.commit(start, end);
     }
 
     return SubtitleTrack(std::move(cues));
@@ -0,0 +1,256 @@
+#include "subs/SubtitleTrack.hpp"
+
+#include "io/MappedFile.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+// Compiled cache: a fixed header followed by the track's arrays exactly as
+// they sit in memory, each section 8-byte aligned, so a mapping of the file
+// can back a SubtitleTrack directly.
+//
+//   header | start[n] | end[n] | textBegin[n + 1]
+//          | nodes[nodeCount] | byStart[m] | byEnd[m] | pad   (kHasIndex)
+//          | text[textBytes]
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'P', 'S', 'U', 'B', 'C', '0', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kByteOrder = 0x01020304;
+constexpr uint32_t kHasIndex = 1;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t srtSize;
+    int64_t srtMtime;
+    uint64_t srtDigest;
+    uint32_t flags;
+    uint32_t root;
+    uint64_t cueCount;
+    uint64_t textBytes;
+    uint64_t nodeCount;
+    uint64_t indexedCount;
+    uint64_t maxOverlap;
+};
+static_assert(sizeof(CacheHeader) % 8 == 0);
+
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t digest = 0;
+};
+
+uint64_t fnv1a(uint64_t h, std::string_view bytes) {
+    for (unsigned char c : bytes) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Size and mtime catch ordinary edits; the digest covers the head, middle and
+// tail of the file, which catches a restored mtime without reading it all.
+std::optional<SourceStamp> stampOf(const std::filesystem::path& srt) {
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(srt, ec);
+    if (ec) return std::nullopt;
+
+    try {
+        const MappedFile file(srt, MappedFile::Access::Random);
+        const std::string_view data = file.view();
+
+        constexpr size_t kWindow = 64u << 10;
+        uint64_t h = fnv1a(0xcbf29ce484222325ULL, {reinterpret_cast<const char*>(&kVersion), 4});
+        h = fnv1a(h, data.substr(0, kWindow));
+        if (data.size() > kWindow) {
+            h = fnv1a(h, data.substr(data.size() / 2, kWindow));
+            h = fnv1a(h, data.substr(data.size() - std::min(kWindow, data.size())));
+        }
+        return SourceStamp{data.size(), static_cast<int64_t>(mtime.time_since_epoch().count()), h};
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+constexpr uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t{7}; }
+
+bool headerMatches(const CacheHeader& h, const SourceStamp& stamp) {
+    return std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 && h.version == kVersion &&
+           h.byteOrder == kByteOrder && h.srtSize == stamp.size && h.srtMtime == stamp.mtime &&
+           h.srtDigest == stamp.digest;
+}
+
+// Unique per process and per save, so concurrent players or batch workers
+// never write into each other's temporary file.
+std::filesystem::path tempFor(const std::filesystem::path& target) {
+    static std::atomic<uint64_t> serial{0};
+    std::filesystem::path tmp = target;
+    tmp += "." + std::to_string(::getpid()) + "-" + std::to_string(serial++) + ".tmp";
+    return tmp;
+}
+
+}  // namespace
+
+std::filesystem::path SubtitleTrack::cacheFor(const std::filesystem::path& srt) {
+    std::filesystem::path p = srt;
+    p += ".subcache";
+    return p;
+}
+
+std::optional<SubtitleTrack> SubtitleTrack::loadCache(const std::filesystem::path& srt) {
+    static_assert(sizeof(IntervalNode) == 24 && std::is_trivially_copyable_v<IntervalNode>,
+                  "IntervalNode is stored in the cache as is");
+
+    const auto stamp = stampOf(srt);
+    if (!stamp) return std::nullopt;
+
+    std::shared_ptr<const MappedFile> file;
+    try {
+        file = std::make_shared<const MappedFile>(cacheFor(srt), MappedFile::Access::Random);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+
+    const char* base = file->data();
+    const uint64_t fileSize = file->size();
+    if (fileSize < sizeof(CacheHeader)) return std::nullopt;
+
+    CacheHeader h{};
+    std::memcpy(&h, base, sizeof(h));
+    if (!headerMatches(h, *stamp)) return std::nullopt;
+
+    const uint64_t n = h.cueCount;
+    const bool indexed = (h.flags & kHasIndex) != 0;
+    if (n >= kNoNode || h.nodeCount > n || h.indexedCount > n) return std::nullopt;
+
+    // Section offsets; the total has to match the file exactly.
+    uint64_t at = sizeof(CacheHeader);
+    const uint64_t startAt = at;
+    at += n * sizeof(int64_t);
+    const uint64_t endAt = at;
+    at += n * sizeof(int64_t);
+    const uint64_t textBeginAt = at;
+    at += (n + 1) * sizeof(uint64_t);
+    const uint64_t nodesAt = at;
+    uint64_t byStartAt = at;
+    uint64_t byEndAt = at;
+    if (indexed) {
+        at += h.nodeCount * sizeof(IntervalNode);
+        byStartAt = at;
+        at += h.indexedCount * sizeof(uint32_t);
+        byEndAt = at;
+        at += h.indexedCount * sizeof(uint32_t);
+        at = align8(at);
+    }
+    const uint64_t textAt = at;
+    if (textAt > fileSize || h.textBytes != fileSize - textAt) return std::nullopt;
+
+    SubtitleTrack track;
+    track.mapping_ = file;
+    track.cues_.start = {reinterpret_cast<const int64_t*>(base + startAt), n};
+    track.cues_.end = {reinterpret_cast<const int64_t*>(base + endAt), n};
+    track.cues_.textBegin = {reinterpret_cast<const uint64_t*>(base + textBeginAt), n + 1};
+    track.cues_.text = base + textAt;
+
+    // A corrupt cache must not turn into out-of-bounds reads later.
+    const CueColumns& c = track.cues_;
+    if (c.textBegin[0] != 0 || c.textBegin[n] != h.textBytes) return std::nullopt;
+    for (uint64_t i = 0; i < n; ++i) {
+        if (c.textBegin[i] > c.textBegin[i + 1]) return std::nullopt;
+        if (i > 0 && c.start[i - 1] > c.start[i]) return std::nullopt;
+    }
+
+    if (!indexed) {
+        track.buildIndex();
+        return track;
+    }
+
+    track.nodes_ = {reinterpret_cast<const IntervalNode*>(base + nodesAt), h.nodeCount};
+    track.byStart_ = {reinterpret_cast<const uint32_t*>(base + byStartAt), h.indexedCount};
+    track.byEnd_ = {reinterpret_cast<const uint32_t*>(base + byEndAt), h.indexedCount};
+    track.root_ = h.root;
+    track.maxOverlap_ = h.maxOverlap;
+
+    if (h.root != kNoNode ? h.root >= h.nodeCount : h.nodeCount != 0) return std::nullopt;
+    // Nodes are written in preorder, so a child always comes after its
+    // parent; anything else could send activeRange round a cycle.
+    for (uint64_t k = 0; k < h.nodeCount; ++k) {
+        const IntervalNode& node = track.nodes_[k];
+        if (node.left != kNoNode && (node.left <= k || node.left >= h.nodeCount)) return std::nullopt;
+        if (node.right != kNoNode && (node.right <= k || node.right >= h.nodeCount)) return std::nullopt;
+        if (uint64_t{node.begin} + node.count > h.indexedCount) return std::nullopt;
+    }
+    for (uint64_t i = 0; i < h.indexedCount; ++i) {
+        if (track.byStart_[i] >= n || track.byEnd_[i] >= n) return std::nullopt;
+    }
+
+    track.active_.reserve(track.maxOverlap_);
+    return track;
+}
+
+bool SubtitleTrack::saveCache(const std::filesystem::path& srt, bool withIndex) const {
+    const auto stamp = stampOf(srt);
+    if (!stamp) return false;
+
+    CacheHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.byteOrder = kByteOrder;
+    h.srtSize = stamp->size;
+    h.srtMtime = stamp->mtime;
+    h.srtDigest = stamp->digest;
+    h.flags = withIndex ? kHasIndex : 0;
+    h.root = withIndex ? root_ : kNoNode;
+    h.cueCount = cues_.size();
+    h.textBytes = cues_.textBegin.back();
+    h.nodeCount = withIndex ? nodes_.size() : 0;
+    h.indexedCount = withIndex ? byStart_.size() : 0;
+    h.maxOverlap = maxOverlap_;
+
+    // Write to a temporary name first so a concurrent reader never sees half a file.
+    const std::filesystem::path target = cacheFor(srt);
+    const std::filesystem::path tmp = tempFor(target);
+
+    bool written = false;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        auto write = [&](const void* p, size_t bytes) {
+            out.write(static_cast<const char*>(p), static_cast<std::streamsize>(bytes));
+        };
+        write(&h, sizeof(h));
+        write(cues_.start.data(), cues_.start.size_bytes());
+        write(cues_.end.data(), cues_.end.size_bytes());
+        write(cues_.textBegin.data(), cues_.textBegin.size_bytes());
+        if (withIndex) {
+            write(nodes_.data(), nodes_.size_bytes());
+            write(byStart_.data(), byStart_.size_bytes());
+            write(byEnd_.data(), byEnd_.size_bytes());
+            const char pad[8] = {};
+            const uint64_t indexBytes = nodes_.size_bytes() + byStart_.size_bytes() + byEnd_.size_bytes();
+            write(pad, align8(indexBytes) - indexBytes);
+        }
+        write(cues_.text, h.textBytes);
+        written = static_cast<bool>(out);
+    }
+
+    // Names are unique now, so a failed write must not leave its file behind.
+    std::error_code ec;
+    if (written) {
+        std::filesystem::rename(tmp, target, ec);
+        if (!ec) return true;
+    }
+
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
@@ -0,0 +1,24 @@
+#include "subs/SubtitleLocator.hpp"
+
+#include <vector>
+
+std::optional<std::filesystem::path>
+autoFindSubtitles(const std::filesystem::path& videoPath) {
+    using namespace std::filesystem;
+
+    path dir  = videoPath.parent_path();
+    path base = videoPath.stem();
+
+    std::vector<path> candidates = {
+        dir / (base.string() + ".srt"),
+        dir / (base.string() + ".en.srt"),
+        dir / (base.string() + ".ru.srt"),
+    };
+
+    for (const auto& p : candidates) {
+        if (exists(p) && is_regular_file(p)) {
+            return p;
+        }
+    }
+    return std::nullopt;
+}
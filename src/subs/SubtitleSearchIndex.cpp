@@ -0,0 +1,282 @@
+#include "subs/SubtitleSearchIndex.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// Decodes the code point at text[i] and advances i. Malformed bytes come
+// back as U+FFFD, one byte at a time.
+char32_t decode(std::string_view text, size_t& i) {
+    const auto b = static_cast<unsigned char>(text[i]);
+    int extra = 0;
+    char32_t cp = 0;
+    if (b < 0x80) {
+        ++i;
+        return b;
+    } else if ((b & 0xE0) == 0xC0) {
+        extra = 1;
+        cp = b & 0x1F;
+    } else if ((b & 0xF0) == 0xE0) {
+        extra = 2;
+        cp = b & 0x0F;
+    } else if ((b & 0xF8) == 0xF0) {
+        extra = 3;
+        cp = b & 0x07;
+    } else {
+        ++i;
+        return 0xFFFD;
+    }
+
+    if (i + extra >= text.size()) {
+        ++i;
+        return 0xFFFD;
+    }
+    for (int k = 1; k <= extra; ++k) {
+        const auto c = static_cast<unsigned char>(text[i + k]);
+        if ((c & 0xC0) != 0x80) {
+            ++i;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    i += 1 + extra;
+    return cp;
+}
+
+void encode(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Letters and digits; punctuation, symbols and typographic quotes and
+// dashes (U+2000 and up to the end of the symbol blocks) split words.
+bool isWordChar(char32_t cp) {
+    if (cp < 0x80) {
+        return (cp >= '0' && cp <= '9') || (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z');
+    }
+    if (cp < 0xC0 || cp == 0xD7 || cp == 0xF7 || cp == 0xFFFD) return false;
+    if (cp >= 0x2000 && cp < 0x2C00) return false;
+    if (cp >= 0x3000 && cp < 0x3040) return false;
+    return true;
+}
+
+char32_t fold(char32_t cp) {
+    if (cp >= 'A' && cp <= 'Z') return cp + 0x20;
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return cp + 0x20;
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 0x20;
+    if (cp == 0x401 || cp == 0x451) return 0x435;  // Ё, ё -> е
+    if (cp >= 0x400 && cp <= 0x40F) return cp + 0x50;
+    return cp;
+}
+
+// Calls fn(word) for every normalized word of text; `word` is scratch.
+template <class Fn>
+void forEachWord(std::string_view text, std::string& word, Fn&& fn) {
+    word.clear();
+    size_t i = 0;
+    while (i < text.size()) {
+        const char32_t cp = decode(text, i);
+        if (isWordChar(cp)) {
+            encode(word, fold(cp));
+        } else if (!word.empty()) {
+            fn(std::string_view(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) fn(std::string_view(word));
+}
+
+struct WordHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+// First element >= id at or after `from`: doubling steps, then a binary
+// search inside the last step. Cheap when the lists differ a lot in size.
+const uint32_t* gallop(const uint32_t* from, const uint32_t* end, uint32_t id) {
+    size_t step = 1;
+    const uint32_t* lo = from;
+    while (lo + step < end && lo[step] < id) {
+        lo += step;
+        step *= 2;
+    }
+    return std::lower_bound(lo, std::min(lo + step + 1, end), id);
+}
+
+}  // namespace
+
+SubtitleSearchIndex::SubtitleSearchIndex(std::vector<CueView> cues, std::shared_ptr<const void> owner)
+    : owner_(std::move(owner))
+    , cues_(std::move(cues))
+{
+    if (cues_.size() >= UINT32_MAX) throw std::runtime_error("Too many cues to index");
+
+    std::stable_sort(cues_.begin(), cues_.end(),
+                     [](const CueView& a, const CueView& b) { return a.start_ms < b.start_ms; });
+
+    // Pass 1: number the words in order of first use and record, per cue,
+    // the distinct words it contains.
+    std::unordered_map<std::string, uint32_t, WordHash, std::equal_to<>> ids;
+    std::vector<uint32_t> lastCue;  // per word, 1 + the last cue it was seen in
+    std::vector<uint32_t> count;    // per word, cues containing it
+    std::vector<uint32_t> occ;
+    std::vector<size_t> occEnd(cues_.size());
+
+    std::string scratch;
+    for (uint32_t c = 0; c < cues_.size(); ++c) {
+        forEachWord(cues_[c].text, scratch, [&](std::string_view w) {
+            auto it = ids.find(w);
+            if (it == ids.end()) {
+                it = ids.emplace(std::string(w), static_cast<uint32_t>(ids.size())).first;
+                lastCue.push_back(0);
+                count.push_back(0);
+            }
+            const uint32_t id = it->second;
+            if (lastCue[id] == c + 1) return;
+            lastCue[id] = c + 1;
+            ++count[id];
+            occ.push_back(id);
+        });
+        occEnd[c] = occ.size();
+    }
+
+    // Sort the vocabulary so lookups are a binary search over the arena.
+    std::vector<std::pair<std::string_view, uint32_t>> sorted;
+    sorted.reserve(ids.size());
+    for (const auto& [w, id] : ids) sorted.emplace_back(w, id);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<uint32_t> rank(sorted.size());
+    size_t arena = 0;
+    for (const auto& [w, id] : sorted) arena += w.size();
+    words_.reserve(arena);
+    wordBegin_.reserve(sorted.size() + 1);
+    postBegin_.reserve(sorted.size() + 1);
+
+    for (uint32_t k = 0; k < sorted.size(); ++k) {
+        const auto& [w, id] = sorted[k];
+        rank[id] = k;
+        words_.insert(words_.end(), w.begin(), w.end());
+        wordBegin_.push_back(static_cast<uint32_t>(words_.size()));
+        postBegin_.push_back(postBegin_.back() + count[id]);
+    }
+
+    // Pass 2: scatter cue ids into the lists. Cues are visited in id order,
+    // so every list comes out sorted.
+    postings_.resize(occ.size());
+    std::vector<uint32_t> cursor(postBegin_.begin(), postBegin_.end() - 1);
+    size_t o = 0;
+    for (uint32_t c = 0; c < cues_.size(); ++c) {
+        for (; o < occEnd[c]; ++o) postings_[cursor[rank[occ[o]]]++] = c;
+    }
+
+    // A bitset is no bigger than the list of a word in over 1/32 of the cues.
+    bitWords_ = (cues_.size() + 63) / 64;
+    denseOf_.assign(words(), kNoBits);
+    uint32_t dense = 0;
+    for (size_t k = 0; k < words(); ++k) {
+        if (size_t{postBegin_[k + 1] - postBegin_[k]} * 32 > cues_.size()) denseOf_[k] = dense++;
+    }
+    bits_.assign(size_t{dense} * bitWords_, 0);
+    for (size_t k = 0; k < words(); ++k) {
+        if (denseOf_[k] == kNoBits) continue;
+        uint64_t* set = bits_.data() + size_t{denseOf_[k]} * bitWords_;
+        for (uint32_t p = postBegin_[k]; p < postBegin_[k + 1]; ++p) {
+            set[postings_[p] / 64] |= uint64_t{1} << (postings_[p] % 64);
+        }
+    }
+}
+
+SubtitleSearchIndex::Term SubtitleSearchIndex::termOf(std::string_view w) const {
+    size_t lo = 0;
+    size_t hi = words();
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (word(mid) < w) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == words() || word(lo) != w) return {};
+
+    Term t;
+    t.ids = {postings_.data() + postBegin_[lo], postBegin_[lo + 1] - postBegin_[lo]};
+    if (denseOf_[lo] != kNoBits) t.bits = bits_.data() + size_t{denseOf_[lo]} * bitWords_;
+    return t;
+}
+
+std::span<const uint32_t> SubtitleSearchIndex::find(std::string_view query, std::vector<uint32_t>& out) const {
+    std::vector<Term> terms;
+    bool missing = false;
+    std::string scratch;
+    forEachWord(query, scratch, [&](std::string_view w) {
+        const Term t = termOf(w);
+        if (t.ids.empty()) missing = true;
+        else terms.push_back(t);
+    });
+    if (missing || terms.empty()) return {};
+
+    std::sort(terms.begin(), terms.end(), [](const Term& a, const Term& b) { return a.ids.size() < b.ids.size(); });
+    if (terms.size() == 1) return terms.front().ids;
+
+    // `out` only ever grows, so a reused buffer is not cleared on every query.
+    if (out.size() < terms.front().ids.size()) out.resize(terms.front().ids.size());
+
+    // Every word dense: AND the bitsets a machine word at a time.
+    if (terms.front().bits) {
+        size_t kept = 0;
+        for (size_t w = 0; w < bitWords_; ++w) {
+            uint64_t m = terms.front().bits[w];
+            for (size_t t = 1; t < terms.size() && m; ++t) m &= terms[t].bits[w];
+            for (; m; m &= m - 1) {
+                out[kept++] = static_cast<uint32_t>(w * 64 + static_cast<size_t>(std::countr_zero(m)));
+            }
+        }
+        return {out.data(), kept};
+    }
+
+    // Otherwise the shortest list is filtered by each other word in turn,
+    // straight into `out`: a bit test for dense words, a forward-only
+    // gallop for sparse ones.
+    std::span<const uint32_t> from = terms.front().ids;
+    for (size_t t = 1; t < terms.size() && !from.empty(); ++t) {
+        size_t kept = 0;
+        if (const uint64_t* bits = terms[t].bits) {
+            for (const uint32_t id : from) {
+                if ((bits[id / 64] >> (id % 64)) & 1) out[kept++] = id;
+            }
+        } else {
+            const uint32_t* it = terms[t].ids.data();
+            const uint32_t* end = it + terms[t].ids.size();
+            for (const uint32_t id : from) {
+                it = gallop(it, end, id);
+                if (it == end) break;
+                if (*it == id) out[kept++] = id;
+            }
+        }
+        from = {out.data(), kept};
+    }
+    return from;
+}
+
+size_t SubtitleSearchIndex::bytes() const noexcept {
+    return cues_.capacity() * sizeof(CueView) + words_.capacity() +
+           (wordBegin_.capacity() + postBegin_.capacity() + postings_.capacity() + denseOf_.capacity()) *
+               sizeof(uint32_t) +
+           bits_.capacity() * sizeof(uint64_t);
+}
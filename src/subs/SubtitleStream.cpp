@@ -0,0 +1,206 @@
+#include "subs/SubtitleStream.hpp"
+
+#include "subs/SrtParser.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+// How far before a seek target the jump-ahead starts, so cues that began
+// earlier and are still on screen get picked up.
+constexpr int64_t kJumpLeadMs = 30'000;
+
+// Targets closer than this to the running parse position just wait for it.
+constexpr size_t kJumpMinBytes = 256u << 10;
+
+SubtitleSnapshot::Chunk makeChunk(std::shared_ptr<const SubtitleTrack> track, size_t begin, size_t end) {
+    SubtitleSnapshot::Chunk chunk;
+    chunk.begin = begin;
+    chunk.end = end;
+    if (const CueRange all = track->startingAfter(INT64_MIN, SIZE_MAX); !all.empty()) {
+        chunk.firstStart = all.front().start_ms;
+        chunk.lastStart = all.back().start_ms;
+        for (const CueView& c : all) chunk.maxEnd = std::max(chunk.maxEnd, c.end_ms);
+    }
+    chunk.track = std::move(track);
+    return chunk;
+}
+
+} // namespace
+
+SubtitleSnapshot::SubtitleSnapshot(std::vector<Chunk> chunks, size_t sourceSize, bool complete,
+                                   std::string error)
+    : chunks_(std::move(chunks))
+    , complete_(complete)
+    , error_(std::move(error))
+{
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+
+    for (size_t i = 0; i < chunks_.size();) {
+        const size_t runBegin = chunks_[i].begin;
+        int64_t lo = kMax;
+        int64_t hi = kMin;
+        size_t j = i;
+        for (; j < chunks_.size() && (j == i || chunks_[j].begin == chunks_[j - 1].end); ++j) {
+            cueCount_ += chunks_[j].track->size();
+            if (chunks_[j].track->size() == 0) continue;
+            lo = std::min(lo, chunks_[j].firstStart);
+            hi = std::max(hi, chunks_[j].lastStart);
+        }
+        if (runBegin == 0) lo = kMin;
+        if (chunks_[j - 1].end >= sourceSize) hi = kMax;
+        if (lo <= hi) covered_.emplace_back(lo, hi);
+        i = j;
+    }
+}
+
+std::span<const CueView> SubtitleSnapshot::activeRange(int64_t t_ms,
+                                                       std::vector<CueView>& out) const {
+    thread_local std::vector<CueView> part;
+
+    out.clear();
+    for (const Chunk& c : chunks_) {
+        if (c.track->size() == 0 || t_ms < c.firstStart || t_ms >= c.maxEnd) continue;
+        for (const CueView& cue : c.track->activeRange(t_ms, part)) out.push_back(cue);
+    }
+
+    // Chunks can arrive out of file order after a jump. k is tiny and runs
+    // are already sorted, so an in-place insertion sort keeps this
+    // allocation-free.
+    for (size_t i = 1; i < out.size(); ++i) {
+        const CueView c = out[i];
+        size_t j = i;
+        for (; j > 0 && out[j - 1].start_ms > c.start_ms; --j) out[j] = out[j - 1];
+        out[j] = c;
+    }
+    return out;
+}
+
+CueRange SubtitleSnapshot::startingAfter(int64_t t_ms, size_t maxCount) const {
+    // The chunk whose next cue comes first; chunks hold start-sorted tracks.
+    CueRange best;
+    for (const Chunk& c : chunks_) {
+        if (c.track->size() == 0 || c.lastStart <= t_ms) continue;
+        const CueRange s = c.track->startingAfter(t_ms, maxCount);
+        if (!s.empty() && (best.empty() || s.front().start_ms < best.front().start_ms)) best = s;
+    }
+    return best;
+}
+
+bool SubtitleSnapshot::covers(int64_t t_ms) const {
+    if (complete_) return true;
+    for (const auto& [lo, hi] : covered_) {
+        if (lo <= t_ms && t_ms <= hi) return true;
+    }
+    return false;
+}
+
+SubtitleStream::SubtitleStream(const std::filesystem::path& path)
+    : path_(path)
+    , file_(std::in_place, path)
+    , snapshot_(std::make_shared<SubtitleSnapshot>())
+    , worker_([this](std::stop_token st) { workerLoop(st); })
+{}
+
+SubtitleStream::SubtitleStream(SubtitleTrack track)
+{
+    std::vector<SubtitleSnapshot::Chunk> chunks;
+    chunks.push_back(makeChunk(std::make_shared<const SubtitleTrack>(std::move(track)), 0, 0));
+    snapshot_ = std::make_shared<const SubtitleSnapshot>(std::move(chunks), 0, true);
+}
+
+SubtitleStream::~SubtitleStream() = default;
+
+std::shared_ptr<const SubtitleSnapshot> SubtitleStream::snapshot() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return snapshot_;
+}
+
+void SubtitleStream::publish(std::vector<SubtitleSnapshot::Chunk> chunks, bool complete,
+                             std::string error) {
+    auto snap = std::make_shared<const SubtitleSnapshot>(std::move(chunks), file_->size(), complete,
+                                                         std::move(error));
+    std::lock_guard<std::mutex> lock(mtx_);
+    snapshot_ = std::move(snap);
+}
+
+void SubtitleStream::workerLoop(std::stop_token st) {
+    const SrtParser parser;
+    const std::string_view data = file_->view();
+
+    std::vector<Range> todo{{0, data.size()}};  // unparsed, ordered by offset
+    std::vector<SubtitleSnapshot::Chunk> chunks;
+    std::shared_ptr<const SubtitleSnapshot> last = snapshot();
+    size_t current = 0;
+
+    try {
+        while (!todo.empty() && !st.stop_requested()) {
+            const int64_t want = wantMs_.exchange(kNoWant, std::memory_order_relaxed);
+            if (want != kNoWant && !last->covers(want)) {
+                const size_t at = parser.cueOffsetBefore(data, want - kJumpLeadMs);
+                auto it = std::find_if(todo.begin(), todo.end(),
+                                       [at](const Range& r) { return at < r.end; });
+                if (it != todo.end()) {
+                    if (at > it->begin && at - it->begin > kJumpMinBytes) {
+                        const Range tail{at, it->end};
+                        it->end = at;
+                        it = todo.insert(it + 1, tail);
+                    }
+                    current = static_cast<size_t>(it - todo.begin());
+                }
+            }
+
+            Range& r = todo[current];
+            CueBuffer cues;
+            const size_t next = parser.parseCues(data.substr(0, r.end), r.begin, kChunkCues, cues);
+
+            SubtitleSnapshot::Chunk chunk =
+                makeChunk(std::make_shared<const SubtitleTrack>(std::move(cues)), r.begin, next);
+            chunks.insert(std::upper_bound(chunks.begin(), chunks.end(), chunk.begin,
+                                           [](size_t off, const SubtitleSnapshot::Chunk& c) {
+                                               return off < c.begin;
+                                           }),
+                          std::move(chunk));
+
+            r.begin = next;
+            if (r.begin >= r.end) {
+                todo.erase(todo.begin() + static_cast<std::ptrdiff_t>(current));
+                // Carry on with what follows; wrap to gaps left by jumps.
+                if (current >= todo.size()) current = 0;
+            }
+
+            publish(chunks, todo.empty());
+            last = snapshot();
+        }
+    } catch (const std::exception& e) {
+        // Keep what was parsed on screen, but say the track stops short and
+        // never let it into the cache, where it would pass for the full file.
+        std::cerr << "Subtitle parse error: " << e.what() << "\n";
+        publish(std::move(chunks), true, e.what());
+        return;
+    }
+
+    if (!todo.empty() || st.stop_requested()) return;
+    try {
+        saveCache(chunks);
+    } catch (const std::exception& e) {
+        std::cerr << "Cannot save subtitle cache: " << e.what() << "\n";
+    }
+}
+
+void SubtitleStream::saveCache(const std::vector<SubtitleSnapshot::Chunk>& chunks) const {
+    // Chunks in file order are the cues in file order; the track's stable sort
+    // then lands exactly where a one-shot parse would.
+    size_t cues = 0;
+    for (const auto& c : chunks) cues += c.track->size();
+
+    CueBuffer all;
+    all.reserve(cues, file_->size());
+    for (const auto& c : chunks) {
+        for (const CueView& cue : c.track->startingAfter(INT64_MIN, SIZE_MAX)) all.append(cue);
+    }
+    SubtitleTrack(std::move(all)).saveCache(path_);
+}
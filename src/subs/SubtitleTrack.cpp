@@ -1,43 +1,192 @@
 #include "subs/SubtitleTrack.hpp"
 
+#include "io/MappedFile.hpp"
+
 #include <algorithm>
+#include <functional>
+#include <numeric>
 
-SubtitleTrack::SubtitleTrack(std::vector<SubtitleCue> cues)
-    : cues_(std::move(cues))
+SubtitleTrack::SubtitleTrack(CueBuffer cues)
+    : storage_(std::make_shared<Storage>())
 {
-    std::sort(cues_.begin(), cues_.end(),
-              [](const SubtitleCue& a, const SubtitleCue& b) {
-                  return a.start_ms < b.start_ms;
-              });
+    storage_->cues = std::move(cues);
+    sortByStart();
+    cues_ = storage_->cues.columns();
+    buildIndex();
 }
 
-const SubtitleCue* SubtitleTrack::activeAt(int64_t t_ms) const {
-    if (cues_.empty()) return nullptr;
+void SubtitleTrack::sortByStart() {
+    CueBuffer& cues = storage_->cues;
+    const std::vector<int64_t>& start = cues.start_;
+    if (std::is_sorted(start.begin(), start.end())) {
+        // Drop the parser's growth slack; the track lives for the whole run.
+        cues.start_.shrink_to_fit();
+        cues.end_.shrink_to_fit();
+        cues.textBegin_.shrink_to_fit();
+        cues.text_.shrink_to_fit();
+        return;
+    }
+
+    std::vector<uint32_t> order(cues.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return start[a] < start[b]; });
+
+    // Rebuild the arena in start order too, so cue identity (text address)
+    // orders the same way as the cues.
+    CueBuffer sorted;
+    sorted.reserve(cues.size(), cues.text_.size());
+    for (uint32_t i : order) sorted.append(cues[i]);
+    cues = std::move(sorted);
+}
 
-    if (hint_ < cues_.size()) {
-        const auto& c = cues_[hint_];
-        if (c.start_ms <= t_ms && t_ms < c.end_ms) return &c;
+void SubtitleTrack::buildIndex() {
+    if (!storage_) storage_ = std::make_shared<Storage>();
+
+    std::vector<uint32_t> ids;
+    ids.reserve(cues_.size());
+    for (size_t i = 0; i < cues_.size(); ++i) {
+        // Empty cues can never be active, keep them out of the tree.
+        if (cues_.start[i] < cues_.end[i]) ids.push_back(static_cast<uint32_t>(i));
     }
 
-    while (hint_ + 1 < cues_.size() && cues_[hint_].end_ms <= t_ms) {
-        ++hint_;
-        const auto& c = cues_[hint_];
-        if (c.start_ms <= t_ms && t_ms < c.end_ms) return &c;
+    storage_->byStart.reserve(ids.size());
+    storage_->byEnd.reserve(ids.size());
+    root_ = buildNode(ids);
+
+    nodes_ = storage_->nodes;
+    byStart_ = storage_->byStart;
+    byEnd_ = storage_->byEnd;
+
+    // Size the result buffer for the deepest overlap so queries never grow it.
+    // Cues are in start order, so one sweep with a min-heap of the ends still
+    // open finds it without sorting every start and end event.
+    std::vector<int64_t> open;
+    size_t maxDepth = 0;
+    for (size_t i = 0; i < cues_.size(); ++i) {
+        if (cues_.start[i] >= cues_.end[i]) continue;
+        while (!open.empty() && open.front() <= cues_.start[i]) {
+            std::pop_heap(open.begin(), open.end(), std::greater<>());
+            open.pop_back();
+        }
+        open.push_back(cues_.end[i]);
+        std::push_heap(open.begin(), open.end(), std::greater<>());
+        maxDepth = std::max(maxDepth, open.size());
     }
+    maxOverlap_ = maxDepth;
+    active_.reserve(maxOverlap_);
+}
 
-    auto it = std::upper_bound(
-        cues_.begin(), cues_.end(), t_ms,
-        [](int64_t t, const SubtitleCue& c) { return t < c.start_ms; });
+uint32_t SubtitleTrack::buildNode(std::vector<uint32_t>& ids) {
+    if (ids.empty()) return kNoNode;
 
-    if (it == cues_.begin()) {
-        hint_ = 0;
-        return nullptr;
+    // ids is ordered by start; the median cue contains its own start, so
+    // every node keeps at least one cue and both halves shrink.
+    const int64_t center = cues_.start[ids[ids.size() / 2]];
+
+    std::vector<uint32_t> left;
+    std::vector<uint32_t> right;
+    std::vector<uint32_t> here;
+
+    for (uint32_t id : ids) {
+        if (cues_.end[id] <= center) left.push_back(id);
+        else if (cues_.start[id] > center) right.push_back(id);
+        else here.push_back(id);
     }
+    ids.clear();
+    ids.shrink_to_fit();
+
+    std::vector<IntervalNode>& nodes = storage_->nodes;
+    const auto nodeIdx = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    IntervalNode node;
+    node.center = center;
+    node.begin = static_cast<uint32_t>(storage_->byStart.size());
+    node.count = static_cast<uint32_t>(here.size());
 
-    --it;
-    hint_ = static_cast<size_t>(std::distance(cues_.begin(), it));
+    storage_->byStart.insert(storage_->byStart.end(), here.begin(), here.end());
+
+    std::stable_sort(here.begin(), here.end(), [&](uint32_t a, uint32_t b) {
+        return cues_.end[a] > cues_.end[b];
+    });
+    storage_->byEnd.insert(storage_->byEnd.end(), here.begin(), here.end());
+
+    node.left = buildNode(left);
+    node.right = buildNode(right);
+
+    nodes[nodeIdx] = node;
+    return nodeIdx;
+}
 
-    const auto& c = *it;
-    if (c.start_ms <= t_ms && t_ms < c.end_ms) return &c;
-    return nullptr;
+std::span<const CueView> SubtitleTrack::activeRange(int64_t t_ms) const {
+    return activeRange(t_ms, active_);
+}
+
+std::span<const CueView>
+SubtitleTrack::activeRange(int64_t t_ms, std::vector<CueView>& out) const {
+    out.clear();
+
+    uint32_t n = root_;
+    while (n != kNoNode) {
+        const IntervalNode& node = nodes_[n];
+
+        if (t_ms < node.center) {
+            // All cues here end after center > t, only the start matters.
+            for (uint32_t i = node.begin; i < node.begin + node.count; ++i) {
+                const uint32_t id = byStart_[i];
+                if (cues_.start[id] > t_ms) break;
+                out.push_back(cues_[id]);
+            }
+            n = node.left;
+        } else {
+            // All cues here start at or before center <= t, only the end matters.
+            for (uint32_t i = node.begin; i < node.begin + node.count; ++i) {
+                const uint32_t id = byEnd_[i];
+                if (cues_.end[id] <= t_ms) break;
+                out.push_back(cues_[id]);
+            }
+            n = node.right;
+        }
+    }
+
+    // k is tiny in practice; insertion sort restores cue order in place.
+    // The arena is laid out in cue order, so text addresses sort like ids.
+    for (size_t i = 1; i < out.size(); ++i) {
+        const CueView c = out[i];
+        size_t j = i;
+        while (j > 0 && out[j - 1].text.data() > c.text.data()) {
+            out[j] = out[j - 1];
+            --j;
+        }
+        out[j] = c;
+    }
+
+    return out;
+}
+
+std::optional<CueView> SubtitleTrack::activeAt(int64_t t_ms) const {
+    auto active = activeRange(t_ms);
+    if (active.empty()) return std::nullopt;
+    return active.back();
+}
+
+CueRange SubtitleTrack::startingAfter(int64_t t_ms, size_t maxCount) const {
+    const std::span<const int64_t> start = cues_.start;
+    const auto it = std::upper_bound(start.begin(), start.end(), t_ms);
+
+    const size_t first = static_cast<size_t>(std::distance(start.begin(), it));
+    const size_t count = std::min(maxCount, start.size() - first);
+    return {cues_, first, first + count};
+}
+
+size_t SubtitleTrack::bytes() const noexcept {
+    size_t n = active_.capacity() * sizeof(CueView);
+    if (mapping_) n += mapping_->size();
+    if (storage_) {
+        n += storage_->cues.bytes() + storage_->nodes.capacity() * sizeof(IntervalNode) +
+             storage_->byStart.capacity() * sizeof(uint32_t) +
+             storage_->byEnd.capacity() * sizeof(uint32_t);
+    }
+    return n;
 }
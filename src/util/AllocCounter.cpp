@@ -0,0 +1,95 @@
+#include "util/AllocCounter.hpp"
+
+#ifdef SUBPLAYER_COUNT_ALLOCS
+
+#include <opencv2/core.hpp>
+
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t tAllocations = 0;
+
+static void* countedAlloc(std::size_t n) {
+    ++tAllocations;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+static void* countedAlignedAlloc(std::size_t n, std::align_val_t al) {
+    ++tAllocations;
+    const auto a = static_cast<std::size_t>(al);
+    if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n) { return countedAlloc(n); }
+void* operator new[](std::size_t n) { return countedAlloc(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    ++tAllocations;
+    return std::malloc(n ? n : 1);
+}
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+    ++tAllocations;
+    return std::malloc(n ? n : 1);
+}
+void* operator new(std::size_t n, std::align_val_t al) { return countedAlignedAlloc(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al) { return countedAlignedAlloc(n, al); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+// cv::Mat pixel buffers come from cv::fastMalloc, not operator new, so the
+// default Mat allocator is wrapped too: every create(), clone() or copyTo()
+// into a Mat without room counts once more for its buffer.
+namespace {
+
+#if CV_VERSION_MAJOR >= 4
+using MatAccess = cv::AccessFlag;
+#else
+using MatAccess = int;
+#endif
+
+class CountingMatAllocator final : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(const cv::MatAllocator* inner) : inner_(inner) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           MatAccess flags, cv::UMatUsageFlags usage) const override {
+        // The delegate records itself as the owner, so buffers go back to it.
+        if (!data) ++tAllocations;
+        return inner_->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+
+    bool allocate(cv::UMatData* u, MatAccess flags, cv::UMatUsageFlags usage) const override {
+        return inner_->allocate(u, flags, usage);
+    }
+
+    void deallocate(cv::UMatData* u) const override { inner_->deallocate(u); }
+
+private:
+    const cv::MatAllocator* inner_;
+};
+
+const bool gMatAllocatorInstalled = [] {
+    static CountingMatAllocator counting(cv::Mat::getDefaultAllocator());
+    cv::Mat::setDefaultAllocator(&counting);
+    return true;
+}();
+
+}  // namespace
+
+bool AllocCounter::enabled() noexcept { return gMatAllocatorInstalled; }
+uint64_t AllocCounter::thisThread() noexcept { return tAllocations; }
+
+#else
+
+bool AllocCounter::enabled() noexcept { return false; }
+uint64_t AllocCounter::thisThread() noexcept { return 0; }
+
+#endif
@@ -0,0 +1,120 @@
+#include "util/FrameStats.hpp"
+
+#include <algorithm>
+#include <bit>
+
+size_t Histogram::bucketOf(uint64_t v) noexcept {
+    if (v < kSub) return static_cast<size_t>(v);
+    const int msb = 63 - std::countl_zero(v);
+    const int shift = msb - kSubBits;
+    return static_cast<size_t>(shift + 1) * kSub + ((v >> shift) & (kSub - 1));
+}
+
+uint64_t Histogram::lowerBound(size_t bucket) noexcept {
+    if (bucket < kSub) return bucket;
+    const int shift = static_cast<int>(bucket / kSub) - 1;
+    return (uint64_t{kSub} | (bucket & (kSub - 1))) << shift;
+}
+
+uint64_t Histogram::upperBound(size_t bucket) noexcept {
+    if (bucket < kSub) return bucket;
+    const int shift = static_cast<int>(bucket / kSub) - 1;
+    return lowerBound(bucket) + ((uint64_t{1} << shift) - 1);
+}
+
+void Histogram::record(uint64_t v) noexcept {
+    buckets_[bucketOf(v)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(v, std::memory_order_relaxed);
+
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (v > seen && !max_.compare_exchange_weak(seen, v, std::memory_order_relaxed)) {}
+}
+
+double Histogram::mean() const noexcept {
+    const uint64_t n = count();
+    return n ? static_cast<double>(sum()) / static_cast<double>(n) : 0.0;
+}
+
+uint64_t Histogram::quantile(double q) const noexcept {
+    const uint64_t n = count();
+    if (n == 0) return 0;
+
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(n) + 0.5));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        seen += buckets_[b].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(max(), lowerBound(b) + (upperBound(b) - lowerBound(b)) / 2);
+        }
+    }
+    return max();
+}
+
+void Histogram::reset() noexcept {
+    for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::writeJson(std::ostream& os, double unit) const {
+    os << "{\"count\": " << count()
+       << ", \"mean\": " << mean() / unit
+       << ", \"p50\": " << static_cast<double>(quantile(0.50)) / unit
+       << ", \"p90\": " << static_cast<double>(quantile(0.90)) / unit
+       << ", \"p99\": " << static_cast<double>(quantile(0.99)) / unit
+       << ", \"max\": " << static_cast<double>(max()) / unit
+       << ", \"buckets\": [";
+    bool first = true;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        const uint64_t c = buckets_[b].load(std::memory_order_relaxed);
+        if (c == 0) continue;
+        os << (first ? "" : ", ") << "[" << static_cast<double>(upperBound(b)) / unit << ", " << c << "]";
+        first = false;
+    }
+    os << "]}";
+}
+
+const char* FrameStats::stageName(Stage s) noexcept {
+    switch (s) {
+        case Read:        return "read";
+        case Subtitles:   return "subtitles";
+        case Hud:         return "hud";
+        case ProgressBar: return "progress_bar";
+        case Show:        return "imshow";
+        case WaitKey:     return "wait_key";
+        default:          return "?";
+    }
+}
+
+void FrameStats::recordFrame(uint64_t ns, uint64_t allocations) noexcept {
+    frame_.record(ns);
+    allocs_.record(allocations);
+}
+
+void FrameStats::recordDrift(int64_t ns) noexcept {
+    lastDrift_.store(ns, std::memory_order_relaxed);
+    drift_.record(static_cast<uint64_t>(ns < 0 ? -ns : ns));
+}
+
+void FrameStats::writeJson(std::ostream& os) const {
+    constexpr double kUs = 1000.0;
+
+    os << "{\n  \"unit\": \"us\",\n"
+       << "  \"frames\": " << frames() << ",\n"
+       << "  \"late\": " << late() << ",\n"
+       << "  \"dropped\": " << dropped() << ",\n"
+       << "  \"frame\": ";
+    frame_.writeJson(os, kUs);
+    os << ",\n  \"stages\": {";
+    for (size_t s = 0; s < StageCount; ++s) {
+        os << (s ? ",\n" : "\n") << "    \"" << stageName(static_cast<Stage>(s)) << "\": ";
+        stages_[s].writeJson(os, kUs);
+    }
+    os << "\n  },\n  \"drift_abs\": ";
+    drift_.writeJson(os, kUs);
+    os << ",\n  \"allocations_per_frame\": ";
+    allocs_.writeJson(os, 1.0);
+    os << "\n}\n";
+}
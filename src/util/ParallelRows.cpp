@@ -0,0 +1,115 @@
+#include "util/ParallelRows.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using RowFn = void (*)(void*, int, int);
+
+class RowPool {
+public:
+    static RowPool& instance() {
+        static RowPool pool;
+        return pool;
+    }
+
+    // False when the pool is busy or has no workers; the caller then runs
+    // the rows itself.
+    bool run(int rows, int chunk, RowFn fn, void* ctx) {
+        std::unique_lock<std::mutex> busy(busyMtx_, std::try_to_lock);
+        if (!busy || workers_.empty()) return false;
+
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            fn_ = fn;
+            ctx_ = ctx;
+            rows_ = rows;
+            chunk_ = chunk;
+            next_.store(0, std::memory_order_relaxed);
+            pending_ = workers_.size();
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        drain();
+
+        std::unique_lock<std::mutex> lk(mtx_);
+        done_.wait(lk, [&] { return pending_ == 0; });
+        return true;
+    }
+
+    ~RowPool() {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+private:
+    RowPool() {
+        const unsigned hw = std::thread::hardware_concurrency();
+        const unsigned n = std::min(hw > 1 ? hw - 1 : 0u, 15u);
+        workers_.reserve(n);
+        for (unsigned i = 0; i < n; ++i) workers_.emplace_back([this] { loop(); });
+    }
+
+    void drain() {
+        for (;;) {
+            const int begin = next_.fetch_add(chunk_, std::memory_order_relaxed);
+            if (begin >= rows_) return;
+            fn_(ctx_, begin, std::min(begin + chunk_, rows_));
+        }
+    }
+
+    void loop() {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                wake_.wait(lk, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+
+            drain();
+
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (--pending_ == 0) done_.notify_one();
+        }
+    }
+
+    std::mutex busyMtx_;  // one job at a time
+
+    std::mutex mtx_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_ = 0;
+    size_t pending_ = 0;
+    bool stop_ = false;
+
+    // Job description, published under mtx_ together with generation_.
+    RowFn fn_ = nullptr;
+    void* ctx_ = nullptr;
+    int rows_ = 0;
+    int chunk_ = 1;
+    std::atomic<int> next_{0};
+
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace
+
+void parallelRows(int rows, int chunkRows, RowFn fn, void* ctx) {
+    chunkRows = std::max(1, chunkRows);
+    if (rows <= chunkRows || !RowPool::instance().run(rows, chunkRows, fn, ctx)) {
+        if (rows > 0) fn(ctx, 0, rows);
+    }
+}
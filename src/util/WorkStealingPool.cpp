@@ -0,0 +1,109 @@
+#include "util/WorkStealingPool.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Which pool and slot the current thread works for, so nested submits stay local.
+thread_local const WorkStealingPool* tPool = nullptr;
+thread_local size_t tSlot = 0;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    threads = std::max(1u, threads);
+    queues_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+
+    threads_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard lk(sleepMtx_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void WorkStealingPool::submit(Task task) {
+    const size_t slot = tPool == this ? tSlot : next_++ % queues_.size();
+    {
+        std::lock_guard lk(sleepMtx_);
+        ++unfinished_;
+    }
+    {
+        // queued_ moves under the deque's lock, so it never counts a task a
+        // woken worker cannot find yet.
+        std::lock_guard lk(queues_[slot]->mtx);
+        queues_[slot]->tasks.push_back(std::move(task));
+        std::lock_guard sleepLk(sleepMtx_);
+        ++queued_;
+    }
+    wake_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock lk(sleepMtx_);
+    idle_.wait(lk, [&] { return unfinished_ == 0; });
+}
+
+bool WorkStealingPool::tryTake(size_t self, Task& out) {
+    {
+        Queue& own = *queues_[self];
+        std::lock_guard lk(own.mtx);
+        if (!own.tasks.empty()) {
+            out = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            std::lock_guard sleepLk(sleepMtx_);
+            --queued_;
+            return true;
+        }
+    }
+
+    for (size_t k = 1; k < queues_.size(); ++k) {
+        Queue& victim = *queues_[(self + k) % queues_.size()];
+        std::lock_guard lk(victim.mtx);
+        if (!victim.tasks.empty()) {
+            out = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            std::lock_guard sleepLk(sleepMtx_);
+            --queued_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t self) {
+    tPool = this;
+    tSlot = self;
+
+    Task task;
+    for (;;) {
+        {
+            std::unique_lock lk(sleepMtx_);
+            wake_.wait(lk, [&] { return stop_ || queued_ > 0; });
+            if (stop_ && queued_ == 0) return;
+        }
+
+        // queued_ > 0 was seen, but another worker may win the race; then
+        // simply go back to sleep.
+        if (!tryTake(self, task)) continue;
+
+        task();
+        task = nullptr;
+
+        bool drained = false;
+        {
+            std::lock_guard lk(sleepMtx_);
+            drained = --unfinished_ == 0;
+        }
+        if (drained) idle_.notify_all();
+    }
+}
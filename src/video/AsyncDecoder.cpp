@@ -0,0 +1,130 @@
+#include "video/AsyncDecoder.hpp"
+
+#include <algorithm>
+
+AsyncDecoder::AsyncDecoder(cv::VideoCapture& cap, size_t capacity, cv::Size frameSize)
+    : cap_(cap)
+    , slots_(std::max<size_t>(1, capacity))
+{
+    if (frameSize.width > 0 && frameSize.height > 0) {
+        for (Slot& s : slots_) s.frame.create(frameSize, CV_8UC3);
+    }
+    thread_ = std::thread(&AsyncDecoder::produce, this);
+}
+
+AsyncDecoder::~AsyncDecoder() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    notFull_.notify_all();
+    notEmpty_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void AsyncDecoder::produce() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            if (count_ == slots_.size() && !stop_) ++producerStalls_;
+            notFull_.wait(lk, [&] { return stop_ || (!eof_ && count_ < slots_.size()); });
+            if (stop_) return;
+        }
+
+        std::unique_lock<std::mutex> capLk(capMtx_);
+
+        size_t idx = 0;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (stop_) return;
+            if (eof_ || count_ == slots_.size()) continue;
+            idx = (head_ + count_) % slots_.size();
+        }
+
+        // The slot is outside [head_, head_ + count_), so the consumer never
+        // looks at it, and seeks and skips wait on capMtx_ until the frame
+        // is either published or dropped.
+        Slot& slot = slots_[idx];
+        const bool ok = cap_.read(slot.frame) && !slot.frame.empty();
+        slot.timeMs = ok ? static_cast<int64_t>(cap_.get(cv::CAP_PROP_POS_MSEC)) : 0;
+
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (ok) ++count_;
+            else eof_ = true;
+        }
+        capLk.unlock();
+        notEmpty_.notify_one();
+    }
+}
+
+bool AsyncDecoder::pop(cv::Mat& frame, int64_t& timeMs) {
+    std::unique_lock<std::mutex> lk(mtx_);
+
+    if (count_ == 0 && !eof_) ++underruns_;
+    notEmpty_.wait(lk, [&] { return stop_ || count_ > 0 || eof_; });
+    if (count_ == 0) return false;
+
+    Slot& slot = slots_[head_];
+    cv::swap(frame, slot.frame);
+    timeMs = slot.timeMs;
+
+    head_ = (head_ + 1) % slots_.size();
+    --count_;
+    lk.unlock();
+
+    notFull_.notify_one();
+    return true;
+}
+
+void AsyncDecoder::seek(const std::function<void(cv::VideoCapture&)>& reposition) {
+    std::lock_guard<std::mutex> capLk(capMtx_);
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        head_ = 0;
+        count_ = 0;
+        eof_ = false;
+    }
+    reposition(cap_);
+    notFull_.notify_one();
+}
+
+size_t AsyncDecoder::skip(size_t n) {
+    std::lock_guard<std::mutex> capLk(capMtx_);
+
+    size_t skipped = 0;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        skipped = std::min(n, count_);
+        head_ = (head_ + skipped) % slots_.size();
+        count_ -= skipped;
+        if (skipped == n || eof_) {
+            notFull_.notify_one();
+            return skipped;
+        }
+    }
+
+    // The ring is empty and, with capMtx_ held, the producer has nothing in
+    // flight: the capture sits right after the last frame handed out.
+
+    bool eof = false;
+    for (; skipped < n; ++skipped) {
+        if (!cap_.grab()) {
+            eof = true;
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (eof) eof_ = true;
+    }
+    notFull_.notify_one();
+    notEmpty_.notify_one();
+    return skipped;
+}
+
+AsyncDecoder::Stats AsyncDecoder::stats() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return {count_, slots_.size(), producerStalls_, underruns_};
+}
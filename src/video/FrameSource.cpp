@@ -0,0 +1,46 @@
+#include "video/FrameSource.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+ConstantRateSource::ConstantRateSource(cv::Size frameSize, double fps, int64_t frameCount) {
+    info_.fps = fps > 1e-6 ? fps : 25.0;
+    info_.frameSize = frameSize;
+    info_.frameCount = std::max<int64_t>(0, frameCount);
+    info_.durationMs = ptsOf(info_.frameCount);
+}
+
+int64_t ConstantRateSource::ptsOf(int64_t i) const {
+    return static_cast<int64_t>(std::floor(static_cast<double>(i) * 1000.0 / info_.fps));
+}
+
+bool ConstantRateSource::read(cv::Mat& frame) {
+    if (next_ >= info_.frameCount) return false;
+
+    frameAt(next_, frame);
+    lastMs_ = ptsOf(next_);
+    ++next_;
+    return true;
+}
+
+size_t ConstantRateSource::skipFrames(size_t n) {
+    const int64_t skipped = std::min(static_cast<int64_t>(n), info_.frameCount - next_);
+    if (skipped <= 0) return 0;
+
+    next_ += skipped;
+    lastMs_ = ptsOf(next_ - 1);
+    return static_cast<size_t>(skipped);
+}
+
+void ConstantRateSource::seekMs(int64_t t_ms, SeekMode) {
+    if (info_.frameCount == 0) return;
+    if (t_ms < 0) t_ms = 0;
+
+    // The frame shown at t_ms is the last one whose pts is not after it;
+    // the division can land one short, so step forward when it does.
+    int64_t i = static_cast<int64_t>(std::floor(static_cast<double>(t_ms) * info_.fps / 1000.0));
+    if (ptsOf(i + 1) <= t_ms) ++i;
+
+    next_ = std::clamp<int64_t>(i, 0, info_.frameCount - 1);
+    lastMs_ = ptsOf(next_);
+}
@@ -0,0 +1,141 @@
+#include "video/RawVideoSource.hpp"
+
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr std::string_view kY4mMagic = "YUV4MPEG2";
+constexpr std::string_view kFrameTag = "FRAME";
+
+std::runtime_error badY4m(const std::filesystem::path& path, const std::string& what) {
+    return std::runtime_error("Bad Y4M file " + path.string() + ": " + what);
+}
+
+bool parseInt(std::string_view s, int64_t& out) {
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && end == s.data() + s.size();
+}
+
+}  // namespace
+
+RawVideoSource::RawVideoSource(MappedFile file, Format format)
+    : ConstantRateSource(format.size, format.fps, static_cast<int64_t>(format.offsets.size()))
+    , file_(std::move(file))
+    , layout_(format.layout)
+    , offsets_(std::move(format.offsets))
+{}
+
+std::unique_ptr<RawVideoSource> RawVideoSource::openY4m(const std::filesystem::path& path) {
+    MappedFile file(path, MappedFile::Access::Sequential);
+    const std::string_view data = file.view();
+
+    const size_t headerEnd = data.find('\n');
+    if (headerEnd == std::string_view::npos || data.substr(0, kY4mMagic.size()) != kY4mMagic) {
+        throw badY4m(path, "no YUV4MPEG2 header");
+    }
+
+    // Space-separated tags after the magic; the ones that do not change how
+    // pixels are laid out (interlacing, aspect, X extensions) are ignored.
+    Format f;
+    f.layout = Layout::I420;
+    int64_t w = 0, h = 0, num = 0, den = 0;
+    std::string_view tags = data.substr(kY4mMagic.size(), headerEnd - kY4mMagic.size());
+    while (!tags.empty()) {
+        const size_t sp = tags.find(' ');
+        const std::string_view tag = tags.substr(0, sp);
+        tags = sp == std::string_view::npos ? std::string_view{} : tags.substr(sp + 1);
+        if (tag.empty()) continue;
+
+        const std::string_view value = tag.substr(1);
+        switch (tag[0]) {
+        case 'W':
+            if (!parseInt(value, w)) throw badY4m(path, "bad width");
+            break;
+        case 'H':
+            if (!parseInt(value, h)) throw badY4m(path, "bad height");
+            break;
+        case 'F': {
+            const size_t colon = value.find(':');
+            if (colon == std::string_view::npos || !parseInt(value.substr(0, colon), num) ||
+                !parseInt(value.substr(colon + 1), den) || num <= 0 || den <= 0) {
+                throw badY4m(path, "bad frame rate");
+            }
+            break;
+        }
+        case 'C':
+            if (value == "mono") f.layout = Layout::Gray;
+            else if (value == "420" || value == "420jpeg" || value == "420mpeg2" || value == "420paldv") f.layout = Layout::I420;
+            else throw badY4m(path, "unsupported colour space " + std::string(value));
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (w <= 0 || h <= 0 || w > 16384 || h > 16384) throw badY4m(path, "missing or bad frame size");
+    if (f.layout == Layout::I420 && (w % 2 || h % 2)) throw badY4m(path, "4:2:0 needs an even frame size");
+    if (num == 0) throw badY4m(path, "missing frame rate");
+
+    f.size = {static_cast<int>(w), static_cast<int>(h)};
+    f.fps = static_cast<double>(num) / static_cast<double>(den);
+
+    const size_t frameBytes = f.layout == Layout::I420 ? static_cast<size_t>(w * h * 3 / 2) : static_cast<size_t>(w * h);
+
+    // Every frame has its own header line, normally a bare FRAME; walking
+    // them touches one page per frame. A truncated last frame is dropped.
+    size_t pos = headerEnd + 1;
+    while (pos < data.size()) {
+        if (data.substr(pos, kFrameTag.size()) != kFrameTag) throw badY4m(path, "expected FRAME");
+        const size_t lineEnd = data.find('\n', pos);
+        if (lineEnd == std::string_view::npos || data.size() - (lineEnd + 1) < frameBytes) break;
+
+        f.offsets.push_back(lineEnd + 1);
+        pos = lineEnd + 1 + frameBytes;
+    }
+    if (f.offsets.empty()) throw badY4m(path, "no complete frames");
+
+    return std::unique_ptr<RawVideoSource>(new RawVideoSource(std::move(file), std::move(f)));
+}
+
+std::unique_ptr<RawVideoSource> RawVideoSource::openBgr(const std::filesystem::path& path, cv::Size frameSize, double fps) {
+    if (frameSize.width <= 0 || frameSize.height <= 0) {
+        throw std::runtime_error("Raw BGR video needs a positive frame size");
+    }
+
+    MappedFile file(path, MappedFile::Access::Sequential);
+
+    Format f;
+    f.layout = Layout::Bgr;
+    f.size = frameSize;
+    f.fps = fps;
+
+    const size_t frameBytes = static_cast<size_t>(frameSize.area()) * 3;
+    const size_t frames = file.size() / frameBytes;
+    if (frames == 0) throw std::runtime_error("Raw BGR video holds no complete frame: " + path.string());
+
+    f.offsets.reserve(frames);
+    for (size_t i = 0; i < frames; ++i) f.offsets.push_back(i * frameBytes);
+
+    return std::unique_ptr<RawVideoSource>(new RawVideoSource(std::move(file), std::move(f)));
+}
+
+void RawVideoSource::frameAt(int64_t i, cv::Mat& frame) {
+    const cv::Size size = frameSize();
+    // The mapping is read-only; FrameSource consumers never write to frames.
+    auto* pixels = const_cast<char*>(file_.data() + offsets_[static_cast<size_t>(i)]);
+
+    switch (layout_) {
+    case Layout::Bgr:
+        frame = cv::Mat(size, CV_8UC3, pixels);
+        break;
+    case Layout::I420:
+        cv::cvtColor(cv::Mat(size.height * 3 / 2, size.width, CV_8UC1, pixels), frame, cv::COLOR_YUV2BGR_I420);
+        break;
+    case Layout::Gray:
+        cv::cvtColor(cv::Mat(size, CV_8UC1, pixels), frame, cv::COLOR_GRAY2BGR);
+        break;
+    }
+}
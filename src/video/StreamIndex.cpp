@@ -0,0 +1,200 @@
+#include "video/StreamIndex.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'P', 'F', 'I', 'D', 'X', '0', '1'};
+
+struct SidecarHeader {
+    char magic[8];
+    uint64_t videoSize;
+    int64_t videoMtime;
+    uint64_t frameCount;
+    uint64_t keyframeCount;
+};
+
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+std::optional<FileStamp> stampOf(const std::filesystem::path& p) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(p, ec);
+    if (ec) return std::nullopt;
+    const auto mtime = std::filesystem::last_write_time(p, ec);
+    if (ec) return std::nullopt;
+    return FileStamp{size, static_cast<int64_t>(mtime.time_since_epoch().count())};
+}
+
+// Raw mode hands out demuxed packets without decoding them, which is both
+// much faster and the only way OpenCV reports keyframe flags.
+bool openRaw(cv::VideoCapture& cap, const std::filesystem::path& video) {
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+    return cap.open(video.string(), cv::CAP_FFMPEG, {cv::CAP_PROP_FORMAT, -1});
+#else
+    (void)cap;
+    (void)video;
+    return false;
+#endif
+}
+
+bool packetIsKeyframe(const cv::VideoCapture& cap) {
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+    return cap.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) > 0.5;
+#else
+    (void)cap;
+    return false;
+#endif
+}
+
+}  // namespace
+
+std::filesystem::path StreamIndex::sidecarFor(const std::filesystem::path& video) {
+    std::filesystem::path p = video;
+    p += ".frameidx";
+    return p;
+}
+
+std::optional<StreamIndex> StreamIndex::build(const std::filesystem::path& video,
+                                              std::stop_token stop) {
+    cv::VideoCapture cap;
+    const bool raw = openRaw(cap, video);
+    if (!raw && !cap.open(video.string())) return std::nullopt;
+
+    // Packets arrive in decode order; keep keyframe timestamps and sort later.
+    std::vector<int64_t> pts;
+    std::vector<int64_t> keyPts;
+
+    const double frames = cap.get(cv::CAP_PROP_FRAME_COUNT);
+    if (frames > 0.5) pts.reserve(static_cast<size_t>(frames) + 16);
+
+    while (cap.grab()) {
+        if (stop.stop_requested()) return std::nullopt;
+
+        const auto t = static_cast<int64_t>(cap.get(cv::CAP_PROP_POS_MSEC));
+        pts.push_back(t);
+        if (raw && packetIsKeyframe(cap)) keyPts.push_back(t);
+    }
+    if (pts.empty()) return std::nullopt;
+
+    StreamIndex idx;
+    std::sort(pts.begin(), pts.end());
+    idx.ptsMs_ = std::move(pts);
+
+    std::sort(keyPts.begin(), keyPts.end());
+    for (int64_t k : keyPts) {
+        auto it = std::lower_bound(idx.ptsMs_.begin(), idx.ptsMs_.end(), k);
+        idx.keyframes_.push_back(static_cast<uint32_t>(std::distance(idx.ptsMs_.begin(), it)));
+    }
+    idx.keyframes_.erase(std::unique(idx.keyframes_.begin(), idx.keyframes_.end()),
+                         idx.keyframes_.end());
+
+    return idx;
+}
+
+std::optional<StreamIndex> StreamIndex::load(const std::filesystem::path& video) {
+    const auto stamp = stampOf(video);
+    if (!stamp) return std::nullopt;
+
+    const std::filesystem::path sidecar = sidecarFor(video);
+    std::error_code ec;
+    const uint64_t fileSize = std::filesystem::file_size(sidecar, ec);
+    if (ec || fileSize < sizeof(SidecarHeader)) return std::nullopt;
+
+    std::ifstream in(sidecar, std::ios::binary);
+    if (!in) return std::nullopt;
+
+    SidecarHeader h{};
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) return std::nullopt;
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) return std::nullopt;
+    if (h.videoSize != stamp->size || h.videoMtime != stamp->mtime) return std::nullopt;
+
+    // Counts are checked against the file before anything is allocated.
+    const uint64_t body = fileSize - sizeof(SidecarHeader);
+    if (h.frameCount == 0 || h.frameCount > body / sizeof(int64_t) ||
+        h.frameCount > UINT32_MAX || h.keyframeCount > h.frameCount) return std::nullopt;
+    if (body != h.frameCount * sizeof(int64_t) + h.keyframeCount * sizeof(uint32_t)) return std::nullopt;
+
+    StreamIndex idx;
+    idx.ptsMs_.resize(h.frameCount);
+    idx.keyframes_.resize(h.keyframeCount);
+
+    in.read(reinterpret_cast<char*>(idx.ptsMs_.data()),
+            static_cast<std::streamsize>(idx.ptsMs_.size() * sizeof(int64_t)));
+    in.read(reinterpret_cast<char*>(idx.keyframes_.data()),
+            static_cast<std::streamsize>(idx.keyframes_.size() * sizeof(uint32_t)));
+    if (!in) return std::nullopt;
+
+    // frameAt and keyframeAtOrBefore bisect both arrays and index ptsMs_
+    // with keyframe ids.
+    if (!std::is_sorted(idx.ptsMs_.begin(), idx.ptsMs_.end())) return std::nullopt;
+    if (std::adjacent_find(idx.keyframes_.begin(), idx.keyframes_.end(), std::greater_equal<>()) !=
+        idx.keyframes_.end()) return std::nullopt;
+    if (!idx.keyframes_.empty() && idx.keyframes_.back() >= h.frameCount) return std::nullopt;
+
+    return idx;
+}
+
+bool StreamIndex::save(const std::filesystem::path& video) const {
+    const auto stamp = stampOf(video);
+    if (!stamp) return false;
+
+    SidecarHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.videoSize = stamp->size;
+    h.videoMtime = stamp->mtime;
+    h.frameCount = ptsMs_.size();
+    h.keyframeCount = keyframes_.size();
+
+    // Write to a temporary name first so a concurrent reader never sees half a file.
+    const std::filesystem::path target = sidecarFor(video);
+    std::filesystem::path tmp = target;
+    tmp += ".tmp";
+
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(ptsMs_.data()),
+                  static_cast<std::streamsize>(ptsMs_.size() * sizeof(int64_t)));
+        out.write(reinterpret_cast<const char*>(keyframes_.data()),
+                  static_cast<std::streamsize>(keyframes_.size() * sizeof(uint32_t)));
+        if (!out) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, target, ec);
+    if (!ec) return true;
+
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+size_t StreamIndex::frameAt(int64_t t_ms) const {
+    auto it = std::upper_bound(ptsMs_.begin(), ptsMs_.end(), t_ms);
+    if (it == ptsMs_.begin()) return 0;
+    return static_cast<size_t>(std::distance(ptsMs_.begin(), it)) - 1;
+}
+
+size_t StreamIndex::keyframeAtOrBefore(size_t frame) const {
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), frame);
+    if (it == keyframes_.begin()) return keyframes_.empty() ? frame : 0;
+    return *(it - 1);
+}
+
+int64_t StreamIndex::durationMs() const {
+    if (ptsMs_.empty()) return 0;
+    if (ptsMs_.size() == 1) return ptsMs_.front();
+
+    // The last frame lasts as long as an average frame.
+    const int64_t span = ptsMs_.back() - ptsMs_.front();
+    return ptsMs_.back() + span / static_cast<int64_t>(ptsMs_.size() - 1);
+}
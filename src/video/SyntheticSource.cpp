@@ -0,0 +1,54 @@
+#include "video/SyntheticSource.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Enough distinct frames that nothing downstream can get away with caching
+// one, without holding gigabytes at 8K.
+constexpr size_t kPoolBytes = size_t{256} << 20;
+constexpr size_t kMaxPool = 16;
+
+int64_t frameCountFor(double fps, int64_t durationMs) {
+    if (fps <= 1e-6 || durationMs <= 0) return 0;
+    return std::max<int64_t>(1, static_cast<int64_t>(std::ceil(static_cast<double>(durationMs) * fps / 1000.0)));
+}
+
+}  // namespace
+
+SyntheticSource::SyntheticSource(cv::Size frameSize, double fps, int64_t durationMs)
+    : ConstantRateSource(frameSize, fps, frameCountFor(fps, durationMs))
+{
+    if (frameSize.width <= 0 || frameSize.height <= 0) {
+        throw std::runtime_error("Synthetic source needs a positive frame size");
+    }
+
+    const size_t frameBytes = static_cast<size_t>(frameSize.area()) * 3;
+    const size_t poolSize = std::clamp<size_t>(kPoolBytes / frameBytes, 1, kMaxPool);
+
+    // A diagonal colour ramp, so scaling and blending have real gradients to
+    // work on, with a bright bar that moves from frame to frame.
+    cv::Mat base(frameSize, CV_8UC3);
+    for (int y = 0; y < base.rows; ++y) {
+        auto* row = base.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < base.cols; ++x) {
+            row[x] = cv::Vec3b(static_cast<uchar>(255 * x / base.cols),
+                               static_cast<uchar>(255 * y / base.rows),
+                               static_cast<uchar>(128 + 127 * ((x / 64 + y / 64) & 1)));
+        }
+    }
+
+    const int barW = std::max(1, frameSize.width / 32);
+    pool_.resize(poolSize);
+    for (size_t k = 0; k < poolSize; ++k) {
+        base.copyTo(pool_[k]);
+        const int x = static_cast<int>((frameSize.width - barW) * k / std::max<size_t>(1, poolSize - 1));
+        pool_[k](cv::Rect(x, 0, barW, frameSize.height)).setTo(cv::Scalar::all(240));
+    }
+}
+
+void SyntheticSource::frameAt(int64_t i, cv::Mat& frame) {
+    frame = pool_[static_cast<size_t>(i) % pool_.size()];
+}
@@ -0,0 +1,152 @@
+#include "video/ThumbnailIndex.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <optional>
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'P', 'T', 'H', 'M', 'B', '0', '1'};
+
+// About a thumbnail per bar pixel on a 1080p window, never denser than
+// one every two seconds. 128x72 BGR is 27 KiB, so the strip stays under
+// 7 MiB however long the video is.
+constexpr int kThumbHeight = 72;
+constexpr size_t kMaxThumbs = 240;
+constexpr int64_t kMinIntervalMs = 2000;
+
+struct SidecarHeader {
+    char magic[8];
+    uint64_t videoSize;
+    int64_t videoMtime;
+    int32_t width;
+    int32_t height;
+    int64_t intervalMs;
+    uint64_t count;
+};
+
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+std::optional<FileStamp> stampOf(const std::filesystem::path& p) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(p, ec);
+    if (ec) return std::nullopt;
+    const auto mtime = std::filesystem::last_write_time(p, ec);
+    if (ec) return std::nullopt;
+    return FileStamp{size, static_cast<int64_t>(mtime.time_since_epoch().count())};
+}
+
+}  // namespace
+
+ThumbnailIndex::ThumbnailIndex(cv::Size thumbSize, int64_t intervalMs, size_t count)
+    : size_(thumbSize)
+    , intervalMs_(intervalMs)
+    , count_(count)
+    , strip_(count * static_cast<size_t>(thumbSize.area()) * 3)
+{}
+
+std::shared_ptr<ThumbnailIndex> ThumbnailIndex::plan(int64_t durationMs, cv::Size frameSize) {
+    if (durationMs <= 0 || frameSize.width <= 0 || frameSize.height <= 0) return nullptr;
+
+    const int64_t interval = std::max<int64_t>(kMinIntervalMs, (durationMs + kMaxThumbs - 1) / kMaxThumbs);
+    const auto count = static_cast<size_t>((durationMs - 1) / interval + 1);
+    const int width = std::max(1, cvRound(static_cast<double>(kThumbHeight) * frameSize.width / frameSize.height));
+
+    return std::make_shared<ThumbnailIndex>(cv::Size(width, kThumbHeight), interval, count);
+}
+
+std::filesystem::path ThumbnailIndex::sidecarFor(const std::filesystem::path& video) {
+    std::filesystem::path p = video;
+    p += ".thumbs";
+    return p;
+}
+
+bool ThumbnailIndex::build(const std::filesystem::path& video, std::stop_token stop) {
+    cv::VideoCapture cap(video.string());
+    if (!cap.isOpened()) return false;
+
+    cv::Mat frame;
+    for (size_t i = ready(); i < count_; ++i) {
+        if (stop.stop_requested()) return false;
+
+        cap.set(cv::CAP_PROP_POS_MSEC, static_cast<double>(static_cast<int64_t>(i) * intervalMs_));
+        if (!cap.read(frame) || frame.empty()) return i > 0;  // the duration was an estimate
+
+        cv::Mat thumb(size_, CV_8UC3, thumbData(i));
+        cv::resize(frame, thumb, size_, 0, 0, cv::INTER_AREA);
+        ready_.store(i + 1, std::memory_order_release);
+    }
+    return true;
+}
+
+std::shared_ptr<ThumbnailIndex> ThumbnailIndex::load(const std::filesystem::path& video) {
+    const auto stamp = stampOf(video);
+    if (!stamp) return nullptr;
+
+    std::ifstream in(sidecarFor(video), std::ios::binary);
+    if (!in) return nullptr;
+
+    SidecarHeader h{};
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) return nullptr;
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) return nullptr;
+    if (h.videoSize != stamp->size || h.videoMtime != stamp->mtime) return nullptr;
+    if (h.width <= 0 || h.height <= 0 || h.width > 4096 || h.height > 4096) return nullptr;
+    if (h.intervalMs <= 0 || h.count == 0 || h.count > (1u << 20)) return nullptr;
+
+    auto idx = std::make_shared<ThumbnailIndex>(cv::Size(h.width, h.height), h.intervalMs,
+                                                static_cast<size_t>(h.count));
+    in.read(reinterpret_cast<char*>(idx->strip_.data()), static_cast<std::streamsize>(idx->strip_.size()));
+    if (!in) return nullptr;
+
+    idx->ready_.store(idx->count_, std::memory_order_release);
+    return idx;
+}
+
+bool ThumbnailIndex::save(const std::filesystem::path& video) const {
+    const size_t n = ready();
+    const auto stamp = stampOf(video);
+    if (n == 0 || !stamp) return false;
+
+    SidecarHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.videoSize = stamp->size;
+    h.videoMtime = stamp->mtime;
+    h.width = size_.width;
+    h.height = size_.height;
+    h.intervalMs = intervalMs_;
+    h.count = n;
+
+    // Write to a temporary name first so a concurrent reader never sees half a file.
+    const std::filesystem::path target = sidecarFor(video);
+    std::filesystem::path tmp = target;
+    tmp += ".tmp";
+
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(strip_.data()), static_cast<std::streamsize>(n * thumbBytes()));
+        if (!out) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, target, ec);
+    if (!ec) return true;
+
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+cv::Mat ThumbnailIndex::nearest(int64_t t_ms) const {
+    const size_t n = ready();
+    if (n == 0) return {};
+
+    const int64_t i = std::clamp<int64_t>((t_ms + intervalMs_ / 2) / intervalMs_, 0,
+                                          static_cast<int64_t>(n) - 1);
+    // The view is read-only in spirit; finished thumbnails never change.
+    return cv::Mat(size_, CV_8UC3, const_cast<uint8_t*>(strip_.data() + static_cast<size_t>(i) * thumbBytes()));
+}
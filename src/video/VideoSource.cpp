@@ -2,52 +2,141 @@
 
 #include <stdexcept>
 
-VideoSource::VideoSource(const std::filesystem::path& videoPath) {
-    cap_.open(videoPath.string());
-    if (!cap_.isOpened()) {
+VideoSource::VideoSource(const std::filesystem::path& videoPath)
+    : cap_(std::make_unique<cv::VideoCapture>())
+{
+    open(videoPath);
+
+    if (auto idx = StreamIndex::load(videoPath)) {
+        useIndex(std::make_shared<const StreamIndex>(std::move(*idx)));
+        return;
+    }
+
+    pendingIndex_ = std::make_shared<PendingIndex>();
+    indexer_ = std::jthread([slot = pendingIndex_, videoPath](std::stop_token stop) {
+        if (auto idx = StreamIndex::build(videoPath, stop)) {
+            idx->save(videoPath);
+            slot->index = std::make_shared<const StreamIndex>(std::move(*idx));
+        }
+        slot->ready.store(true, std::memory_order_release);
+    });
+}
+
+VideoSource::VideoSource(const std::filesystem::path& videoPath,
+                         std::shared_ptr<const StreamIndex> index)
+    : cap_(std::make_unique<cv::VideoCapture>())
+{
+    open(videoPath);
+    useIndex(std::move(index));
+}
+
+void VideoSource::open(const std::filesystem::path& videoPath) {
+    cap_->open(videoPath.string());
+    if (!cap_->isOpened()) {
         throw std::runtime_error("Cannot open video: " + videoPath.string());
     }
     cv::Mat probe;
-    if (!cap_.read(probe) || probe.empty()) {
+    if (!cap_->read(probe) || probe.empty()) {
         throw std::runtime_error("Video opened but cannot read first frame (missing codec/backend?)");
     }
-    cap_.set(cv::CAP_PROP_POS_FRAMES, 0);
+    cap_->set(cv::CAP_PROP_POS_FRAMES, 0);
+
+    double f = cap_->get(cv::CAP_PROP_FPS);
+    info_.fps = (f > 1e-6) ? f : 25.0;
+
+    info_.frameSize = {static_cast<int>(cap_->get(cv::CAP_PROP_FRAME_WIDTH)),
+                       static_cast<int>(cap_->get(cv::CAP_PROP_FRAME_HEIGHT))};
 
+    double frames = cap_->get(cv::CAP_PROP_FRAME_COUNT);
+    if (f > 1e-6 && frames > 0.5) {
+        info_.frameCount = static_cast<int64_t>(frames);
+        info_.durationMs = static_cast<int64_t>((frames / f) * 1000.0);
+    }
 }
 
-bool VideoSource::read(cv::Mat& frame) {
-    return cap_.read(frame);
+void VideoSource::adoptIndex() {
+    if (!pendingIndex_ || !pendingIndex_->ready.load(std::memory_order_acquire)) return;
+
+    auto index = std::move(pendingIndex_->index);
+    pendingIndex_.reset();
+    useIndex(std::move(index));
 }
 
-int64_t VideoSource::timeMs() const {
-    double ms = cap_.get(cv::CAP_PROP_POS_MSEC);
-    return static_cast<int64_t>(ms);
+void VideoSource::useIndex(std::shared_ptr<const StreamIndex> index) {
+    index_ = std::move(index);
+    if (!index_) return;
+
+    info_.frameCount = static_cast<int64_t>(index_->frameCount());
+    info_.durationMs = index_->durationMs();
 }
 
-void VideoSource::seekMs(int64_t t_ms) {
-    if (t_ms < 0) t_ms = 0;
-    cap_.set(cv::CAP_PROP_POS_MSEC, static_cast<double>(t_ms));
+void VideoSource::positionCapture(cv::VideoCapture& cap, int64_t t_ms, SeekMode mode) const {
+    if (!index_ || index_->frameCount() == 0) {
+        cap.set(cv::CAP_PROP_POS_MSEC, static_cast<double>(t_ms));
+        return;
+    }
+
+    const size_t target = index_->frameAt(t_ms);
+    const size_t key = index_->keyframeAtOrBefore(target);
+
+    cap.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(key));
+    if (mode == SeekMode::Keyframe) return;
+
+    for (size_t f = key; f < target; ++f) {
+        if (!cap.grab()) break;
+    }
 }
 
-double VideoSource::fps() const {
-    double f = cap_.get(cv::CAP_PROP_FPS);
-    return (f > 1e-6) ? f : 25.0;
+void VideoSource::startAsync(size_t capacity) {
+    if (async_) {
+        async_.reset();
+        positionCapture(*cap_, lastTimeMs_);
+    }
+    if (capacity == 0) return;
+
+    lastTimeMs_ = static_cast<int64_t>(cap_->get(cv::CAP_PROP_POS_MSEC));
+    async_ = std::make_unique<AsyncDecoder>(*cap_, capacity, info_.frameSize);
 }
 
-cv::Size VideoSource::frameSize() const {
-    int w = static_cast<int>(cap_.get(cv::CAP_PROP_FRAME_WIDTH));
-    int h = static_cast<int>(cap_.get(cv::CAP_PROP_FRAME_HEIGHT));
-    return {w, h};
+AsyncDecoder::Stats VideoSource::asyncStats() const {
+    return async_ ? async_->stats() : AsyncDecoder::Stats{};
 }
 
-int64_t VideoSource::durationMs() const {
-    double fps = cap_.get(cv::CAP_PROP_FPS);
-    double frames = cap_.get(cv::CAP_PROP_FRAME_COUNT);
+bool VideoSource::read(cv::Mat& frame) {
+    adoptIndex();
+    if (async_) return async_->pop(frame, lastTimeMs_);
+    return cap_->read(frame);
+}
 
-    if (fps > 1e-6 && frames > 0.5) {
-        double ms = (frames / fps) * 1000.0;
-        return static_cast<int64_t>(ms);
-    }
+size_t VideoSource::skipFrames(size_t n) {
+    adoptIndex();
+    if (async_) return async_->skip(n);
+
+    size_t skipped = 0;
+    while (skipped < n && cap_->grab()) ++skipped;
+    return skipped;
+}
+
+int64_t VideoSource::timeMs() const {
+    if (async_) return lastTimeMs_;
+    double ms = cap_->get(cv::CAP_PROP_POS_MSEC);
+    return static_cast<int64_t>(ms);
+}
 
-    return 0;
+void VideoSource::seekMs(int64_t t_ms, SeekMode mode) {
+    if (t_ms < 0) t_ms = 0;
+    adoptIndex();
+
+    if (async_) {
+        async_->seek([&](cv::VideoCapture& cap) { positionCapture(cap, t_ms, mode); });
+
+        // Until the next pop, report the frame the seek lands on.
+        lastTimeMs_ = t_ms;
+        if (index_ && index_->frameCount() > 0) {
+            const size_t target = index_->frameAt(t_ms);
+            lastTimeMs_ = index_->ptsMs(mode == SeekMode::Keyframe ? index_->keyframeAtOrBefore(target) : target);
+        }
+        return;
+    }
+    positionCapture(*cap_, t_ms, mode);
 }